@@ -20,47 +20,23 @@
 ****************************************************************
 ****************************************************************/
 
+#ifndef TECTO_ALLOCATIONCOUNTER_HPP
+#define TECTO_ALLOCATIONCOUNTER_HPP
+
 ////////////////////////////////////////////////
-// Tecto library
-#include <Crust.hpp>
+// C++ Standard Library
+#include <cstddef>
 ////////////////////////////////////////////////
 
-Crust::Crust(unsigned int time)
-: mHeight(100)
-, mIsContinental(false)
-, mTimeCreated(time)
-{
-}
-
-void Crust::offsetHeight(int offset)
-{
-    mHeight += offset;
-}
-
-void Crust::setHeight(unsigned int height)
-{
-    mHeight = height;
-}
-
-
-unsigned int Crust::getHeight() const
-{
-    return mHeight;
-}
-
-bool Crust::isContinental() const
-{
-    return mIsContinental;
-}
-
-
-
-void Crust::setContinental(bool flag)
-{
-    mIsContinental = flag;
-}
-
-unsigned int Crust::getTimeCreated() const
-{
-    return mTimeCreated;
-}
+/*
+ * Build with TECTO_COUNT_ALLOCATIONS defined to replace the global operator
+ * new and count every heap allocation the program makes. Lithosphere then
+ * aborts after any tick that allocated without growing one of its buffers.
+ * Buffers grow by doubling, so that only ticks that move more cells than any
+ * before them, e.g. the first long ones, allocate.
+ *
+ * Without TECTO_COUNT_ALLOCATIONS the count is always 0.
+ */
+std::size_t getAllocationCount();
+
+#endif // TECTO_ALLOCATIONCOUNTER_HPP
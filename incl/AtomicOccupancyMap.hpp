@@ -0,0 +1,94 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_ATOMICOCCUPANCYMAP_HPP
+#define TECTO_ATOMICOCCUPANCYMAP_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Counts how many crusts occupy each cell of the world, from many threads at
+ * once.
+ *
+ * Every cell has an 8-bit atomic counter. increment and decrement return the
+ * count they left behind, so the one thread that takes a cell above 1 or
+ * down to 0 knows that it did. It can solve the collision or note the empty
+ * cell right away, without locks. The counters are relaxed: they order
+ * nothing but themselves.
+ *
+ * Unlike OccupancyMap, the counters do not saturate, and a counter may dip
+ * below 0 while a crust that leaves a cell is counted before another that
+ * arrives. Once every thread is done the counts are exact.
+ *
+ * Cells are stored column by column.
+ */
+class AtomicOccupancyMap
+{
+    public:
+                        AtomicOccupancyMap(unsigned int sizeX, unsigned int sizeY, int count);
+
+        int             increment(unsigned int x, unsigned int y); // Returns the new count.
+        int             decrement(unsigned int x, unsigned int y); // Returns the new count.
+        int             getCount(unsigned int x, unsigned int y) const;
+        void            setCount(unsigned int x, unsigned int y, int count);
+
+        // Call function(x, y) for every cell with a count above 1.
+        template <typename Function>
+        void            forEachCrowdedCell(Function function) const;
+        // Call function(x, y) for every cell with a count below 1.
+        template <typename Function>
+        void            forEachEmptyCell(Function function) const;
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        unsigned int                            mSizeX;
+        unsigned int                            mSizeY;
+        std::unique_ptr<std::atomic<int8_t>[]>  mCounts;
+};
+
+template <typename Function>
+void AtomicOccupancyMap::forEachCrowdedCell(Function function) const
+{
+    for(unsigned int x = 0; x < mSizeX; x++)
+        for(unsigned int y = 0; y < mSizeY; y++)
+            if(getCount(x, y) > 1)
+                function(x, y);
+}
+
+template <typename Function>
+void AtomicOccupancyMap::forEachEmptyCell(Function function) const
+{
+    for(unsigned int x = 0; x < mSizeX; x++)
+        for(unsigned int y = 0; y < mSizeY; y++)
+            if(getCount(x, y) < 1)
+                function(x, y);
+}
+
+#endif // TECTO_ATOMICOCCUPANCYMAP_HPP
@@ -0,0 +1,128 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_BORDER_HPP
+#define TECTO_BORDER_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <BorderCrust.hpp>
+#include <ChainCode.hpp>
+#include <Fixed.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Closed loop of border crusts stored as a structure of arrays.
+ *
+ * Crusts are addressed by their position along the loop. The position after
+ * the last crust is the first crust again, so neighbours are found with
+ * getNext and getPrevious. Positions shift when splice() inserts or erases
+ * crusts.
+ *
+ * The original indices never change after a crust is added and neighbouring
+ * crusts start out in neighbouring cells, so they are kept as a chain code
+ * (see ChainCode.hpp). Walk them with getOriginalIndices rather than looking
+ * them up one by one. Each crust also keeps a CrustHandle to its source
+ * crust, so that the heightmap is reached without going through the chain.
+ *
+ * A crust added to close a gap in the border does not sit in the middle of
+ * its original cell, so it also has an original offset from the stored
+ * (wrapped) original index to where it really started. The offset undoes
+ * the wrap as well. Other crusts have a zero offset.
+ *
+ * Each crust also has an outward normal, perpendicular to the line between
+ * its neighbours. Normals are not normalized and are only as fresh as the
+ * last updateNormals(); they are meant for sign tests. splice() only
+ * recomputes the normals of the crusts whose neighbours it changed.
+ */
+class Border
+{
+    public:
+        // A crust to add in splice().
+        struct Insertion
+        {
+            std::size_t             mPosition; // Inserted before the crust at this position.
+            sf::Vector2i            mIndex;
+            sf::Vector2i            mOriginalIndex;
+            sf::Vector2<Coordinate> mOriginalOffset;
+            sf::Vector2<Coordinate> mRadiusVector;
+        };
+
+                        Border(const std::vector<BorderCrust>& crusts, sf::Vector2i worldSize);
+
+        // Erase every crust whose flag in erase is set and add the insertions,
+        // sorted by position. The crusts in between are moved once, in place.
+        // Takes its temporary buffers from arena.
+        void            splice(const bool* erase, const Insertion* insertions, std::size_t insertionCount, ScratchArena& arena);
+
+        std::size_t     getSize() const;
+        std::size_t     getCapacity() const; // Crusts that fit before splice() has to allocate.
+        std::size_t     getNext(std::size_t position) const;
+        std::size_t     getPrevious(std::size_t position) const;
+
+        const sf::Vector2i& getIndex(std::size_t position) const;
+        void            setIndex(std::size_t position, sf::Vector2i index);
+        sf::Vector2i    getOriginalIndex(std::size_t position) const;
+        ChainCode::Decoder getOriginalIndices(std::size_t position = 0) const;
+        sf::Vector2<Coordinate> getRadiusVector(std::size_t position) const;
+        const CrustHandle& getSourceHandle(std::size_t position) const;
+
+        Coordinate*     getRadiiX();
+        Coordinate*     getRadiiY();
+        const Coordinate* getOriginalOffsetsX() const;
+        const Coordinate* getOriginalOffsetsY() const;
+
+        void            updateNormals(); // Recompute every normal from the radius vectors.
+        sf::Vector2<Coordinate> getNormal(std::size_t position) const;
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        void            updateNormal(std::size_t position);
+        double          getCross(std::size_t from, std::size_t to) const;
+        double          getRunCross(std::size_t position, std::size_t count) const;
+        void            resize(std::size_t size);
+        CrustHandle     createSourceHandle(sf::Vector2i originalIndex) const;
+
+        sf::Vector2i                mWorldSize;
+        uint16_t                    mPlate;
+        std::vector<sf::Vector2i>   mIndices;
+        ChainCode                   mOriginalIndices;
+        std::vector<CrustHandle>    mSourceHandles;
+        std::vector<Coordinate>     mRadiiX;
+        std::vector<Coordinate>     mRadiiY;
+        std::vector<Coordinate>     mOffsetsX;      // Original offsets.
+        std::vector<Coordinate>     mOffsetsY;
+        std::vector<Coordinate>     mNormalsX;
+        std::vector<Coordinate>     mNormalsY;
+        double                      mArea;          // Twice the signed area of the loop of radius vectors.
+        int                         mOrientation;   // 1 if the loop goes clockwise on screen, -1 if not.
+};
+
+#endif // TECTO_BORDER_HPP
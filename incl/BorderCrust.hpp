@@ -3,7 +3,7 @@
 
 ////////////////////////////////////////////////
 // Tecto library
-#include <Crust.hpp>
+#include <CrustHandle.hpp>
 /****************************************************************
 ****************************************************************
 *
@@ -37,7 +37,7 @@
 class BorderCrust
 {
     public:
-                BorderCrust(sf::Vector2i index, Crust& mSourceCrust);
+                BorderCrust(sf::Vector2i index, CrustHandle sourceCrust);
 
         void    update();
 
@@ -48,12 +48,12 @@ class BorderCrust
         sf::Vector2i getOriginalIndex() const;
         const sf::Vector2i& getIndex() const;
         const sf::Vector2f& getRadiusVector() const;
-        Crust& getSourceCrust();
+        const CrustHandle& getSourceHandle() const;
 
 
     protected:
-        Crust&          mSourceCrust;
-        const sf::Vector2i    mOriginalIndex;
+        CrustHandle     mSourceCrust;
+        sf::Vector2i    mOriginalIndex;
         sf::Vector2i    mIndex;
         sf::Vector2f    mRadiusVector; // Difference-vector between mPos and the crust's rotational center. (see Plate::moveBorder to see it in use)
 };
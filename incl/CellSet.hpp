@@ -0,0 +1,162 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_CELLSET_HPP
+#define TECTO_CELLSET_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Compressed set of cell indices (x * worldSizeY + y).
+ *
+ * The cells are split into chunks of 65536 by their upper 16 bits. A chunk
+ * is stored in whichever of three forms is smallest: a sorted array of the
+ * lower 16 bits, a 65536-bit bitmap, or sorted runs of consecutive cells.
+ * A solid plate is a few runs per column, so it costs memory in proportion
+ * to its outline rather than its area, and no chunk ever costs more than one
+ * bit per cell. Union, intersection and counting work chunk by chunk.
+ *
+ * The form is chosen again by insertRange(), getUnion() and
+ * getIntersection(). insert() and erase() only change the form of a chunk
+ * when it outgrows the others.
+ */
+class CellSet
+{
+    public:
+                        CellSet();
+
+        void            insert(uint32_t cell);
+        void            insertRange(uint32_t first, uint32_t last); // Insert [first, last).
+        void            erase(uint32_t cell);
+        void            clear();
+
+        bool            contains(uint32_t cell) const;
+        bool            isEmpty() const;
+        std::size_t     getCount() const;
+
+        CellSet         getUnion(const CellSet& other) const;
+        CellSet         getIntersection(const CellSet& other) const;
+        std::size_t     getIntersectionCount(const CellSet& other) const;
+
+        // Call function(cell) for every cell in ascending order.
+        template <typename Function>
+        void            forEachCell(Function function) const;
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        static const std::size_t MAX_ARRAY_SIZE = 4096; // Beyond this a bitmap is smaller than an array.
+        static const std::size_t BITMAP_WORDS = 65536 / 64;
+
+        // The cells from mStart to mLast, both included, so that one run can
+        // hold a whole chunk.
+        struct Run
+        {
+            uint16_t    mStart;
+            uint16_t    mLast;
+        };
+
+        struct Chunk
+        {
+            explicit Chunk(uint16_t key);
+
+            bool        isBitmap() const;
+            bool        isRuns() const;
+            bool        contains(uint16_t low) const;
+            void        insert(uint16_t low);
+            void        insertRange(uint32_t first, uint32_t last); // Lower 16 bits [first, last). last may be 65536.
+            void        erase(uint16_t low);
+            void        toBitmap();
+            void        toArray();
+            void        toRuns();
+            void        fit(); // Switch to the smallest form.
+            std::size_t getRunCount() const;
+
+            // Call function(low) for every cell in ascending order.
+            template <typename Function>
+            void        forEachLow(Function function) const;
+
+            uint16_t                mKey;
+            uint32_t                mCount;
+            std::vector<uint16_t>   mArray;     // Sorted. Used when mBitmap and mRuns are empty.
+            std::vector<uint64_t>   mBitmap;
+            std::vector<Run>        mRuns;      // Sorted, with gaps between them.
+        };
+
+        static Chunk    unite(const Chunk& a, const Chunk& b);
+        static Chunk    intersect(const Chunk& a, const Chunk& b);
+        static std::size_t getIntersectionCount(const Chunk& a, const Chunk& b);
+
+        Chunk*          findChunk(uint16_t key);
+        const Chunk*    findChunk(uint16_t key) const;
+        Chunk&          getChunk(uint16_t key);
+
+        std::vector<Chunk>  mChunks; // Sorted by key.
+};
+
+template <typename Function>
+void CellSet::forEachCell(Function function) const
+{
+    for(const Chunk& chunk : mChunks)
+    {
+        uint32_t high = uint32_t(chunk.mKey) << 16;
+        chunk.forEachLow([high, &function](uint32_t low)
+        {
+            function(high | low);
+        });
+    }
+}
+
+template <typename Function>
+void CellSet::Chunk::forEachLow(Function function) const
+{
+    if(isBitmap())
+    {
+        for(std::size_t i = 0; i < BITMAP_WORDS; i++)
+        {
+            uint64_t word = mBitmap[i];
+            while(word != 0)
+            {
+                function(uint32_t(i * 64 + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+    }
+    else if(isRuns())
+    {
+        for(const Run& run : mRuns)
+            for(uint32_t low = run.mStart; low <= run.mLast; low++)
+                function(low);
+    }
+    else
+    {
+        for(uint16_t low : mArray)
+            function(uint32_t(low));
+    }
+}
+
+#endif // TECTO_CELLSET_HPP
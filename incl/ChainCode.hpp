@@ -0,0 +1,125 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_CHAINCODE_HPP
+#define TECTO_CHAINCODE_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Topology.hpp>
+#include <Splice.hpp>
+#include <ScratchArena.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// Super Fast Media Library (SFML)
+#include <SFML/System/Vector2.hpp>
+////////////////////////////////////////////////
+
+/*
+ * Freeman chain code of a sequence of cells.
+ *
+ * The first cell is stored as is. Every following cell is stored as a
+ * 3-bit direction from the cell before it, which wraps around the edges of
+ * the world as the Topology says. A cell that is not one of the 8 neighbours of the cell before it
+ * is stored as a jump with its full coordinates. A border is made up of
+ * neighbouring cells, so jumps are rare.
+ *
+ * Cells are appended with pushBack, or replaced a run at a time with
+ * splice (see Splice.hpp). A splice moves the codes after each run once and
+ * only encodes the new cells and the first cell kept after each run again.
+ *
+ * Use a Decoder to walk the cells in order. Random access starts from the
+ * nearest checkpoint before it, which stores the cell at some position.
+ * Appending stores one every CHECKPOINT_INTERVAL cells. A splice keeps the
+ * checkpoints of the cells it keeps, adds its own and drops the ones it does
+ * not need, so that checkpoints stay at most 2 * CHECKPOINT_INTERVAL apart.
+ */
+class ChainCode
+{
+    public:
+        static const std::size_t CHECKPOINT_INTERVAL = 64;
+
+        class Decoder
+        {
+            public:
+                                    Decoder(const ChainCode& chain, std::size_t position);
+
+                const sf::Vector2i& operator*() const;
+                Decoder&            operator++();
+                std::size_t         getPosition() const;
+
+            private:
+                const ChainCode*    mChain;
+                std::size_t         mPosition;
+                std::size_t         mNextJump;
+                sf::Vector2i        mCell;
+        };
+
+                        ChainCode(sf::Vector2i worldSize);
+                        ChainCode(sf::Vector2i worldSize, const std::vector<sf::Vector2i>& cells);
+
+        void            pushBack(sf::Vector2i cell);
+        // The new cells of every run follow each other in cells. Takes its
+        // temporary buffers from arena.
+        void            splice(const SpliceRun* runs, std::size_t runCount, const sf::Vector2i* cells, ScratchArena& arena);
+        void            clear(); // Keeps the memory.
+        void            reserve(std::size_t size); // Room for size cells, up to half of them jumps.
+        sf::Vector2i    get(std::size_t position) const;
+
+        std::size_t     getSize() const;
+        Decoder         getDecoder(std::size_t position = 0) const;
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        typedef std::pair<uint32_t, sf::Vector2i> Jump;         // Position and cell.
+        typedef std::pair<uint32_t, sf::Vector2i> Checkpoint;   // Position and cell.
+
+        static const unsigned int CODES_PER_WORD = 21;
+        static const std::size_t MAX_CHECKPOINT_GAP = 2 * CHECKPOINT_INTERVAL;
+        static const int DIRECTIONS[8][2];
+
+        unsigned int    getCode(std::size_t position) const;
+        void            setCode(std::size_t position, unsigned int code);
+        bool            encode(std::size_t position, sf::Vector2i previous, sf::Vector2i cell); // True for a jump.
+        sf::Vector2i    step(sf::Vector2i cell, unsigned int code) const;
+        std::size_t     findJump(std::size_t position) const;
+        const Checkpoint& findCheckpoint(std::size_t position) const; // Last one at or before position.
+        std::size_t     thinCheckpoints(Checkpoint* checkpoints, std::size_t count) const;
+
+        Topology                    mTopology;
+        std::size_t                 mSize;
+        sf::Vector2i                mLast;          // Cell at mSize - 1, so that appending needs no decoding.
+        std::vector<uint64_t>       mCodes;         // Code of cell i is the direction from cell i - 1.
+        std::vector<Jump>           mJumps;         // Sorted by position.
+        std::vector<Checkpoint>     mCheckpoints;   // Sorted by position. The first is at position 0.
+};
+
+#endif // TECTO_CHAINCODE_HPP
@@ -20,19 +20,31 @@
 ****************************************************************
 ****************************************************************/
 
+
 #ifndef TECTO_CRUST_HPP
 #define TECTO_CRUST_HPP
 
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstddef>
+////////////////////////////////////////////////
 
+template <class Payload>
+class CrustMap;
 
 // This is essentially the crust that is not on the plate's border.
 // Maybe possible to only have some of the outermost Crusts loaded into memory.
 // If border is updated, then load nearby Crusts to memory either on the main thread or on another thread.
 // This would only be necessary for big maps. Bigger maps take longer to tick and therefore the other thread would have more time to load to memory.
+//
+// Crust does not own any data. It is a view of one cell in a CrustMap, which stores
+// each crust property in its own plane. Only the properties of the map's payload
+// (see CrustPayload.hpp) can be used.
+template <class Payload>
 class Crust
 {
     public:
-                    Crust(unsigned int time);
+                    Crust(CrustMap<Payload>& map, std::size_t index);
 
 
 
@@ -42,13 +54,85 @@ class Crust
         void    offsetHeight(int offset);
         void    setHeight(unsigned int);
 
+        void    offsetSediment(int offset);
+        void    setSediment(unsigned int);
+
         unsigned int        getHeight() const;
         unsigned int        getTimeCreated() const;
+        unsigned int        getSediment() const;
+
+        std::size_t         getIndex() const;
 
     private:
-        unsigned int        mHeight;
-        bool                mIsContinental;
-        const unsigned int  mTimeCreated;
+        CrustMap<Payload>*  mMap;
+        std::size_t         mIndex;
 };
 
+template <class Payload>
+Crust<Payload>::Crust(CrustMap<Payload>& map, std::size_t index)
+: mMap(&map)
+, mIndex(index)
+{
+}
+
+template <class Payload>
+void Crust<Payload>::offsetHeight(int offset)
+{
+    mMap->offsetHeight(mIndex, offset);
+}
+
+template <class Payload>
+void Crust<Payload>::setHeight(unsigned int height)
+{
+    mMap->setHeight(mIndex, height);
+}
+
+template <class Payload>
+void Crust<Payload>::offsetSediment(int offset)
+{
+    mMap->offsetSediment(mIndex, offset);
+}
+
+template <class Payload>
+void Crust<Payload>::setSediment(unsigned int thickness)
+{
+    mMap->setSediment(mIndex, thickness);
+}
+
+template <class Payload>
+unsigned int Crust<Payload>::getHeight() const
+{
+    return mMap->getHeight(mIndex);
+}
+
+template <class Payload>
+bool Crust<Payload>::isContinental() const
+{
+    return mMap->isContinental(mIndex);
+}
+
+template <class Payload>
+void Crust<Payload>::setContinental(bool flag)
+{
+    mMap->setContinental(mIndex, flag);
+}
+
+template <class Payload>
+unsigned int Crust<Payload>::getTimeCreated() const
+{
+    return mMap->getTimeCreated(mIndex);
+}
+
+template <class Payload>
+unsigned int Crust<Payload>::getSediment() const
+{
+    return mMap->getSediment(mIndex);
+}
+
+template <class Payload>
+std::size_t Crust<Payload>::getIndex() const
+{
+    return mIndex;
+}
+
 #endif // TECTO_CRUST_HPP
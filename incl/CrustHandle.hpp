@@ -0,0 +1,55 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_CRUSTHANDLE_HPP
+#define TECTO_CRUSTHANDLE_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstdint>
+////////////////////////////////////////////////
+
+/*
+ * Refers to a crust by value instead of by address.
+ *
+ * mCell is the crust's cell in the world, x * worldSizeY + y, and mPlate is
+ * the index of the plate that owns it. The handle is resolved through
+ * CrustMap, so it stays valid when the heightmap storage is reallocated or
+ * laid out differently (see GridLayout.hpp) and can be copied around freely.
+ */
+struct CrustHandle
+{
+    CrustHandle()
+    : mCell(0)
+    , mPlate(0)
+    {};
+
+    CrustHandle(uint32_t cell, uint16_t plate)
+    : mCell(cell)
+    , mPlate(plate)
+    {};
+
+    uint32_t    mCell;
+    uint16_t    mPlate;
+};
+
+#endif // TECTO_CRUSTHANDLE_HPP
@@ -0,0 +1,121 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_CRUSTMAP_HPP
+#define TECTO_CRUSTMAP_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Crust.hpp>
+#include <CrustHandle.hpp>
+#include <CrustPayload.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Structure-of-arrays storage for all crust in the world.
+ *
+ * Each crust property lives in its own plane, and Payload decides which
+ * planes there are (see CrustPayload.hpp). The planes' accessors take a
+ * storage index and are inherited from Payload. Passes that only care about
+ * heights can run over getHeights() and never touch the other planes. Crust
+ * is a lightweight view of a single cell.
+ */
+template <class Payload>
+class CrustMap : public Payload
+{
+    public:
+                    CrustMap(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool isContinental, unsigned int time);
+
+        Crust<Payload>  operator()(unsigned int x, unsigned int y);
+        Crust<Payload>  operator[](std::size_t index);
+        Crust<Payload>  operator[](const CrustHandle& handle);
+
+        CrustHandle     getHandle(unsigned int x, unsigned int y, uint16_t plate) const;
+
+        std::size_t     getIndex(unsigned int x, unsigned int y) const;
+        unsigned int    getSizeX() const;
+        unsigned int    getSizeY() const;
+        std::size_t     getCellCount() const;
+};
+
+template <class Payload>
+CrustMap<Payload>::CrustMap(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool isContinental, unsigned int time)
+: Payload(sizeX, sizeY, height, isContinental, time)
+{
+}
+
+template <class Payload>
+Crust<Payload> CrustMap<Payload>::operator()(unsigned int x, unsigned int y)
+{
+    return Crust<Payload>(*this, getIndex(x, y));
+}
+
+template <class Payload>
+Crust<Payload> CrustMap<Payload>::operator[](std::size_t index)
+{
+    return Crust<Payload>(*this, index);
+}
+
+template <class Payload>
+Crust<Payload> CrustMap<Payload>::operator[](const CrustHandle& handle)
+{
+    return Crust<Payload>(*this, getIndex(handle.mCell / getSizeY(), handle.mCell % getSizeY()));
+}
+
+template <class Payload>
+CrustHandle CrustMap<Payload>::getHandle(unsigned int x, unsigned int y, uint16_t plate) const
+{
+    return CrustHandle(x * getSizeY() + y, plate);
+}
+
+template <class Payload>
+std::size_t CrustMap<Payload>::getIndex(unsigned int x, unsigned int y) const
+{
+    return this->getHeights().getIndex(x, y);
+}
+
+template <class Payload>
+unsigned int CrustMap<Payload>::getSizeX() const
+{
+    return this->getHeights().getSizeX();
+}
+
+template <class Payload>
+unsigned int CrustMap<Payload>::getSizeY() const
+{
+    return this->getHeights().getSizeY();
+}
+
+template <class Payload>
+std::size_t CrustMap<Payload>::getCellCount() const
+{
+    return this->getHeights().getCellCount();
+}
+
+#endif // TECTO_CRUSTMAP_HPP
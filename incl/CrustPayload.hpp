@@ -0,0 +1,148 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_CRUSTPAYLOAD_HPP
+#define TECTO_CRUSTPAYLOAD_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Grid.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Per-cell crust data is split into planes, one per property. A payload is a
+ * set of planes, and CrustMap<Payload> stores exactly those planes. A
+ * property that is not in the payload takes no memory and is never touched,
+ * and asking for it is a compile error.
+ *
+ * Payloads:
+ * - PreviewPayload: height only. Smallest footprint, for quick previews.
+ * - StandardPayload: height, continental flag and age. What a full run needs.
+ * - ResearchPayload: StandardPayload plus sediment thickness.
+ *
+ * A new payload derives from the planes it needs and sums their memory
+ * usage. All payloads take the same constructor arguments and ignore the
+ * ones they have no plane for.
+ */
+
+// Heights are 16-bit and saturate instead of wrapping.
+class HeightPlane
+{
+    public:
+        static const unsigned int MAX_HEIGHT = UINT16_MAX;
+
+                        HeightPlane(unsigned int sizeX, unsigned int sizeY, unsigned int height);
+
+        void            offsetHeight(std::size_t index, int offset);
+        void            setHeight(std::size_t index, unsigned int height);
+        unsigned int    getHeight(std::size_t index) const;
+
+        Grid<uint16_t>&         getHeights();
+        const Grid<uint16_t>&   getHeights() const;
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        Grid<uint16_t>  mHeights;
+};
+
+// The continental flag is packed into one bit per cell.
+class ContinentalPlane
+{
+    public:
+                        ContinentalPlane(std::size_t cellCount, bool isContinental);
+
+        bool            isContinental(std::size_t index) const;
+        void            setContinental(std::size_t index, bool flag);
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        std::vector<uint64_t>   mContinentalMask;
+};
+
+// The creation time is quantized to TIME_QUANTUM years and stored in 16 bits.
+class AgePlane
+{
+    public:
+        static const unsigned int TIME_QUANTUM = 1000; // Years per unit in the age plane.
+
+                        AgePlane(unsigned int sizeX, unsigned int sizeY, unsigned int time);
+
+        void            setTimeCreated(std::size_t index, unsigned int time);
+        unsigned int    getTimeCreated(std::size_t index) const;
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        Grid<uint16_t>  mTimesCreated;
+};
+
+// Sediment thickness is 16-bit and saturates like the heights.
+class SedimentPlane
+{
+    public:
+        static const unsigned int MAX_SEDIMENT = UINT16_MAX;
+
+                        SedimentPlane(unsigned int sizeX, unsigned int sizeY, unsigned int thickness);
+
+        void            offsetSediment(std::size_t index, int offset);
+        void            setSediment(std::size_t index, unsigned int thickness);
+        unsigned int    getSediment(std::size_t index) const;
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        Grid<uint16_t>  mSediments;
+};
+
+
+struct PreviewPayload : HeightPlane
+{
+                    PreviewPayload(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool isContinental, unsigned int time);
+
+    std::size_t     getMemoryUsage() const; // In bytes.
+};
+
+struct StandardPayload : HeightPlane, ContinentalPlane, AgePlane
+{
+                    StandardPayload(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool isContinental, unsigned int time);
+
+    std::size_t     getMemoryUsage() const; // In bytes.
+};
+
+struct ResearchPayload : StandardPayload, SedimentPlane
+{
+                    ResearchPayload(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool isContinental, unsigned int time);
+
+    std::size_t     getMemoryUsage() const; // In bytes.
+};
+
+#endif // TECTO_CRUSTPAYLOAD_HPP
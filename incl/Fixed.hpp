@@ -0,0 +1,262 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_FIXED_HPP
+#define TECTO_FIXED_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstdint>
+#include <cmath>
+////////////////////////////////////////////////
+
+/*
+ * Signed Q16.16 fixed-point number.
+ *
+ * Every operation is integer arithmetic, so results are bit-identical on
+ * every compiler and platform and with any floating-point flags. The range
+ * is roughly +-32768 with a resolution of 1/65536. See MAX_FIXED_WORLD_SIZE
+ * for how large a world that covers.
+ */
+class Fixed
+{
+    public:
+        static const int        FRACTION_BITS = 16;
+        static const int32_t    ONE = int32_t(1) << FRACTION_BITS;
+
+                        Fixed();
+                        Fixed(int value);
+        explicit        Fixed(float value); // Rounded to the nearest fixed-point number.
+        explicit        Fixed(double value);
+        static Fixed    fromRaw(int32_t raw);
+
+        explicit        operator float() const;
+        explicit        operator double() const;
+        int32_t         getRaw() const;
+
+        Fixed           operator-() const;
+        Fixed&          operator+=(Fixed other);
+        Fixed&          operator-=(Fixed other);
+        Fixed&          operator*=(Fixed other);
+        Fixed&          operator/=(Fixed other);
+
+    private:
+        int32_t         mRaw;
+};
+
+Fixed   operator+(Fixed a, Fixed b);
+Fixed   operator-(Fixed a, Fixed b);
+Fixed   operator*(Fixed a, Fixed b);
+Fixed   operator/(Fixed a, Fixed b);
+bool    operator==(Fixed a, Fixed b);
+bool    operator!=(Fixed a, Fixed b);
+bool    operator<(Fixed a, Fixed b);
+bool    operator>(Fixed a, Fixed b);
+bool    operator<=(Fixed a, Fixed b);
+bool    operator>=(Fixed a, Fixed b);
+
+/*
+ * Binary angle. The full range of the integer is one turn, so adding angles
+ * wraps around exactly.
+ */
+typedef uint32_t Angle;
+
+Angle   degreesToAngle(Fixed degrees);
+float   angleToDegrees(Angle angle);
+
+// Looked up in a table built with integer arithmetic only.
+Fixed   fixedSin(Angle angle);
+Fixed   fixedCos(Angle angle);
+
+Fixed   abs(Fixed value);
+int     roundToInt(Fixed value); // Halves are rounded up.
+int     roundToInt(float value);
+int     floorToInt(Fixed value);
+int     floorToInt(float value);
+
+
+// Number type of plate poses and border positions.
+// Define TECTO_FIXED_POINT to simulate in fixed point. The same seed then
+// gives a bit-identical world everywhere.
+#ifdef TECTO_FIXED_POINT
+typedef Fixed   Coordinate;
+#else
+typedef float   Coordinate;
+#endif
+
+// Largest side of a world simulated in fixed point. A border crust is placed
+// at the rotational center of its plate (less than one world size) plus its
+// turned radius vector (less than sqrt(2) world sizes per axis), which must
+// stay below 32768 before it is wrapped into the world.
+const int MAX_FIXED_WORLD_SIZE = 13568;
+
+
+inline Fixed::Fixed()
+: mRaw(0)
+{
+}
+
+inline Fixed::Fixed(int value)
+: mRaw(value * ONE)
+{
+}
+
+inline Fixed::Fixed(float value)
+: mRaw(std::lround(value * ONE))
+{
+}
+
+inline Fixed::Fixed(double value)
+: mRaw(std::lround(value * ONE))
+{
+}
+
+inline Fixed Fixed::fromRaw(int32_t raw)
+{
+    Fixed fixed;
+    fixed.mRaw = raw;
+    return fixed;
+}
+
+inline Fixed::operator float() const
+{
+    return float(mRaw) / ONE;
+}
+
+inline Fixed::operator double() const
+{
+    return double(mRaw) / ONE;
+}
+
+inline int32_t Fixed::getRaw() const
+{
+    return mRaw;
+}
+
+inline Fixed Fixed::operator-() const
+{
+    return fromRaw(-mRaw);
+}
+
+inline Fixed& Fixed::operator+=(Fixed other)
+{
+    mRaw += other.mRaw;
+    return *this;
+}
+
+inline Fixed& Fixed::operator-=(Fixed other)
+{
+    mRaw -= other.mRaw;
+    return *this;
+}
+
+// Products are rounded towards negative infinity.
+inline Fixed& Fixed::operator*=(Fixed other)
+{
+    mRaw = (int64_t(mRaw) * other.mRaw) >> FRACTION_BITS;
+    return *this;
+}
+
+// Quotients are rounded towards zero.
+inline Fixed& Fixed::operator/=(Fixed other)
+{
+    mRaw = int64_t(mRaw) * ONE / other.mRaw;
+    return *this;
+}
+
+inline Fixed operator+(Fixed a, Fixed b)
+{
+    return a += b;
+}
+
+inline Fixed operator-(Fixed a, Fixed b)
+{
+    return a -= b;
+}
+
+inline Fixed operator*(Fixed a, Fixed b)
+{
+    return a *= b;
+}
+
+inline Fixed operator/(Fixed a, Fixed b)
+{
+    return a /= b;
+}
+
+inline bool operator==(Fixed a, Fixed b)
+{
+    return a.getRaw() == b.getRaw();
+}
+
+inline bool operator!=(Fixed a, Fixed b)
+{
+    return a.getRaw() != b.getRaw();
+}
+
+inline bool operator<(Fixed a, Fixed b)
+{
+    return a.getRaw() < b.getRaw();
+}
+
+inline bool operator>(Fixed a, Fixed b)
+{
+    return a.getRaw() > b.getRaw();
+}
+
+inline bool operator<=(Fixed a, Fixed b)
+{
+    return a.getRaw() <= b.getRaw();
+}
+
+inline bool operator>=(Fixed a, Fixed b)
+{
+    return a.getRaw() >= b.getRaw();
+}
+
+inline Fixed abs(Fixed value)
+{
+    return value.getRaw() < 0 ? -value : value;
+}
+
+inline int roundToInt(Fixed value)
+{
+    return (value.getRaw() + Fixed::ONE / 2) >> Fixed::FRACTION_BITS;
+}
+
+inline int roundToInt(float value)
+{
+    return std::floor(value + 0.5f);
+}
+
+inline int floorToInt(Fixed value)
+{
+    return value.getRaw() >> Fixed::FRACTION_BITS;
+}
+
+inline int floorToInt(float value)
+{
+    return std::floor(value);
+}
+
+#endif // TECTO_FIXED_HPP
@@ -0,0 +1,265 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_GRID_HPP
+#define TECTO_GRID_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <GridLayout.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+////////////////////////////////////////////////
+
+/*
+ * Two-dimensional grid stored in one contiguous buffer.
+ *
+ * Where cell (x, y) is stored is decided by Layout (see GridLayout.hpp).
+ * With the default ColumnMajorLayout cell (x, y) lives at x * sizeY + y.
+ * Iterating from begin() to end() visits the cells in storage order, which
+ * for a tiled layout means tile by tile. Use forEachCell to also get the
+ * coordinates of each cell.
+ */
+template <class T, class Layout = GridLayout>
+class Grid
+{
+    public:
+        // A view of one column (IS_COLUMN) or one row of the grid.
+        template <class CellType, bool IS_COLUMN>
+        class Slice
+        {
+            public:
+                Slice(CellType* cells, const Layout& layout, unsigned int coordinate, unsigned int size)
+                : mCells(cells)
+                , mLayout(&layout)
+                , mCoordinate(coordinate)
+                , mSize(size)
+                {};
+
+                CellType& operator[](unsigned int i) const
+                {
+                    return IS_COLUMN ? mCells[mLayout->getIndex(mCoordinate, i)] : mCells[mLayout->getIndex(i, mCoordinate)];
+                };
+
+                unsigned int getSize() const { return mSize; }
+
+            private:
+                CellType*       mCells;
+                const Layout*   mLayout;
+                unsigned int    mCoordinate;
+                unsigned int    mSize;
+        };
+
+        typedef Slice<T, true>          Column;
+        typedef Slice<const T, true>    ConstColumn;
+        typedef Slice<T, false>         Row;
+        typedef Slice<const T, false>   ConstRow;
+
+        typedef T*          iterator;
+        typedef const T*    const_iterator;
+
+                        Grid();
+                        Grid(unsigned int sizeX, unsigned int sizeY, const T& value = T());
+
+        T&              operator()(unsigned int x, unsigned int y);
+        const T&        operator()(unsigned int x, unsigned int y) const;
+        T&              operator[](std::size_t index);
+        const T&        operator[](std::size_t index) const;
+
+        std::size_t     getIndex(unsigned int x, unsigned int y) const;
+        unsigned int    getSizeX() const;
+        unsigned int    getSizeY() const;
+        std::size_t     getCellCount() const; // Number of stored cells, including any padding.
+        const Layout&   getLayout() const;
+
+        Column          getColumn(unsigned int x);
+        ConstColumn     getColumn(unsigned int x) const;
+        Row             getRow(unsigned int y);
+        ConstRow        getRow(unsigned int y) const;
+
+        // Call function(x, y, cell) for every cell in storage order.
+        template <typename Function>
+        void            forEachCell(Function function);
+
+        T*              getData();
+        const T*        getData() const;
+        iterator        begin();
+        iterator        end();
+        const_iterator  begin() const;
+        const_iterator  end() const;
+
+        void            fill(const T& value);
+
+    private:
+        Layout          mLayout;
+        std::vector<T>  mCells;
+};
+
+template <class T, class Layout>
+Grid<T, Layout>::Grid()
+: mLayout(0, 0)
+{
+}
+
+template <class T, class Layout>
+Grid<T, Layout>::Grid(unsigned int sizeX, unsigned int sizeY, const T& value)
+: mLayout(sizeX, sizeY)
+, mCells(mLayout.getStorageSize(), value)
+{
+}
+
+template <class T, class Layout>
+T& Grid<T, Layout>::operator()(unsigned int x, unsigned int y)
+{
+    return mCells[getIndex(x, y)];
+}
+
+template <class T, class Layout>
+const T& Grid<T, Layout>::operator()(unsigned int x, unsigned int y) const
+{
+    return mCells[getIndex(x, y)];
+}
+
+template <class T, class Layout>
+T& Grid<T, Layout>::operator[](std::size_t index)
+{
+    return mCells[index];
+}
+
+template <class T, class Layout>
+const T& Grid<T, Layout>::operator[](std::size_t index) const
+{
+    return mCells[index];
+}
+
+template <class T, class Layout>
+std::size_t Grid<T, Layout>::getIndex(unsigned int x, unsigned int y) const
+{
+    return mLayout.getIndex(x, y);
+}
+
+template <class T, class Layout>
+unsigned int Grid<T, Layout>::getSizeX() const
+{
+    return mLayout.getSizeX();
+}
+
+template <class T, class Layout>
+unsigned int Grid<T, Layout>::getSizeY() const
+{
+    return mLayout.getSizeY();
+}
+
+template <class T, class Layout>
+std::size_t Grid<T, Layout>::getCellCount() const
+{
+    return mCells.size();
+}
+
+template <class T, class Layout>
+const Layout& Grid<T, Layout>::getLayout() const
+{
+    return mLayout;
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::Column Grid<T, Layout>::getColumn(unsigned int x)
+{
+    return Column(mCells.data(), mLayout, x, getSizeY());
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::ConstColumn Grid<T, Layout>::getColumn(unsigned int x) const
+{
+    return ConstColumn(mCells.data(), mLayout, x, getSizeY());
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::Row Grid<T, Layout>::getRow(unsigned int y)
+{
+    return Row(mCells.data(), mLayout, y, getSizeX());
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::ConstRow Grid<T, Layout>::getRow(unsigned int y) const
+{
+    return ConstRow(mCells.data(), mLayout, y, getSizeX());
+}
+
+template <class T, class Layout> template <typename Function>
+void Grid<T, Layout>::forEachCell(Function function)
+{
+    T* cells = mCells.data();
+    mLayout.forEachCell([&](unsigned int x, unsigned int y, std::size_t index)
+    {
+        function(x, y, cells[index]);
+    });
+}
+
+template <class T, class Layout>
+T* Grid<T, Layout>::getData()
+{
+    return mCells.data();
+}
+
+template <class T, class Layout>
+const T* Grid<T, Layout>::getData() const
+{
+    return mCells.data();
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::iterator Grid<T, Layout>::begin()
+{
+    return mCells.data();
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::iterator Grid<T, Layout>::end()
+{
+    return mCells.data() + mCells.size();
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::const_iterator Grid<T, Layout>::begin() const
+{
+    return mCells.data();
+}
+
+template <class T, class Layout>
+typename Grid<T, Layout>::const_iterator Grid<T, Layout>::end() const
+{
+    return mCells.data() + mCells.size();
+}
+
+template <class T, class Layout>
+void Grid<T, Layout>::fill(const T& value)
+{
+    std::fill(mCells.begin(), mCells.end(), value);
+}
+
+#endif // TECTO_GRID_HPP
@@ -0,0 +1,222 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_GRIDLAYOUT_HPP
+#define TECTO_GRIDLAYOUT_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstddef>
+#include <cstdint>
+////////////////////////////////////////////////
+
+/*
+ * A layout decides where cell (x, y) of a Grid is stored.
+ *
+ * Every layout provides getIndex(x, y), the number of stored cells
+ * (which may include padding) and forEachCell, which visits every cell
+ * of the world in storage order.
+ */
+
+// Cells are stored column by column. Cell (x, y) lives at x * sizeY + y.
+class ColumnMajorLayout
+{
+    public:
+                        ColumnMajorLayout(unsigned int sizeX, unsigned int sizeY);
+
+        std::size_t     getIndex(unsigned int x, unsigned int y) const;
+        std::size_t     getStorageSize() const;
+        unsigned int    getSizeX() const;
+        unsigned int    getSizeY() const;
+
+        // Call function(x, y, index) for every cell in storage order.
+        template <typename Function>
+        void            forEachCell(Function function) const;
+
+    private:
+        unsigned int    mSizeX;
+        unsigned int    mSizeY;
+};
+
+/*
+ * Cells are stored in square tiles of 2^TILE_BITS cells per side. The tiles
+ * are stored column by column and the cells inside each tile in Z-order
+ * (Morton order), so cells that are close in any direction are usually
+ * close in memory too. The world is padded up to a whole number of tiles.
+ */
+template <unsigned int TILE_BITS>
+class TiledLayout
+{
+    public:
+        static const unsigned int TILE_SIZE = 1u << TILE_BITS;
+        static const unsigned int TILE_CELLS = TILE_SIZE * TILE_SIZE;
+
+                        TiledLayout(unsigned int sizeX, unsigned int sizeY);
+
+        std::size_t     getIndex(unsigned int x, unsigned int y) const;
+        std::size_t     getStorageSize() const;
+        unsigned int    getSizeX() const;
+        unsigned int    getSizeY() const;
+
+        // Call function(x, y, index) for every cell in storage order, i.e. tile by tile.
+        template <typename Function>
+        void            forEachCell(Function function) const;
+
+    private:
+        static uint32_t spreadBits(uint32_t value);
+        static uint32_t compactBits(uint32_t value);
+
+        unsigned int    mSizeX;
+        unsigned int    mSizeY;
+        unsigned int    mTilesY;
+        std::size_t     mStorageSize;
+};
+
+
+inline ColumnMajorLayout::ColumnMajorLayout(unsigned int sizeX, unsigned int sizeY)
+: mSizeX(sizeX)
+, mSizeY(sizeY)
+{
+}
+
+inline std::size_t ColumnMajorLayout::getIndex(unsigned int x, unsigned int y) const
+{
+    return static_cast<std::size_t>(x) * mSizeY + y;
+}
+
+inline std::size_t ColumnMajorLayout::getStorageSize() const
+{
+    return static_cast<std::size_t>(mSizeX) * mSizeY;
+}
+
+inline unsigned int ColumnMajorLayout::getSizeX() const
+{
+    return mSizeX;
+}
+
+inline unsigned int ColumnMajorLayout::getSizeY() const
+{
+    return mSizeY;
+}
+
+template <typename Function>
+void ColumnMajorLayout::forEachCell(Function function) const
+{
+    std::size_t index = 0;
+    for(unsigned int x = 0; x < mSizeX; x++)
+        for(unsigned int y = 0; y < mSizeY; y++)
+            function(x, y, index++);
+}
+
+
+template <unsigned int TILE_BITS>
+TiledLayout<TILE_BITS>::TiledLayout(unsigned int sizeX, unsigned int sizeY)
+: mSizeX(sizeX)
+, mSizeY(sizeY)
+, mTilesY((sizeY + TILE_SIZE - 1) >> TILE_BITS)
+{
+    std::size_t tilesX = (sizeX + TILE_SIZE - 1) >> TILE_BITS;
+    mStorageSize = tilesX * mTilesY * TILE_CELLS;
+}
+
+template <unsigned int TILE_BITS>
+std::size_t TiledLayout<TILE_BITS>::getIndex(unsigned int x, unsigned int y) const
+{
+    std::size_t tile = static_cast<std::size_t>(x >> TILE_BITS) * mTilesY + (y >> TILE_BITS);
+    uint32_t morton = spreadBits(x & (TILE_SIZE - 1)) | (spreadBits(y & (TILE_SIZE - 1)) << 1);
+    return tile * TILE_CELLS + morton;
+}
+
+template <unsigned int TILE_BITS>
+std::size_t TiledLayout<TILE_BITS>::getStorageSize() const
+{
+    return mStorageSize;
+}
+
+template <unsigned int TILE_BITS>
+unsigned int TiledLayout<TILE_BITS>::getSizeX() const
+{
+    return mSizeX;
+}
+
+template <unsigned int TILE_BITS>
+unsigned int TiledLayout<TILE_BITS>::getSizeY() const
+{
+    return mSizeY;
+}
+
+template <unsigned int TILE_BITS> template <typename Function>
+void TiledLayout<TILE_BITS>::forEachCell(Function function) const
+{
+    std::size_t tileCount = mStorageSize / TILE_CELLS;
+    for(std::size_t tile = 0; tile < tileCount; tile++)
+    {
+        unsigned int tileX = (tile / mTilesY) << TILE_BITS;
+        unsigned int tileY = (tile % mTilesY) << TILE_BITS;
+        std::size_t first = tile * TILE_CELLS;
+
+        for(uint32_t morton = 0; morton < TILE_CELLS; morton++)
+        {
+            unsigned int x = tileX + compactBits(morton);
+            unsigned int y = tileY + compactBits(morton >> 1);
+
+            // Skip the padding outside the world.
+            if(x < mSizeX && y < mSizeY)
+                function(x, y, first + morton);
+        }
+    }
+}
+
+// Insert a zero bit above each of the lowest 16 bits of value.
+template <unsigned int TILE_BITS>
+uint32_t TiledLayout<TILE_BITS>::spreadBits(uint32_t value)
+{
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+// Inverse of spreadBits. Gather every other bit, starting with the lowest.
+template <unsigned int TILE_BITS>
+uint32_t TiledLayout<TILE_BITS>::compactBits(uint32_t value)
+{
+    value &= 0x55555555;
+    value = (value | (value >> 1)) & 0x33333333;
+    value = (value | (value >> 2)) & 0x0F0F0F0F;
+    value = (value | (value >> 4)) & 0x00FF00FF;
+    value = (value | (value >> 8)) & 0x0000FFFF;
+    return value;
+}
+
+
+// Layout used by every Grid unless told otherwise, such as the heightmap and
+// the surface. Define TECTO_TILED_GRID to store them in 64x64 Z-ordered tiles.
+// The occupancy map is not a Grid and keeps its own layout.
+#ifdef TECTO_TILED_GRID
+typedef TiledLayout<6>      GridLayout;
+#else
+typedef ColumnMajorLayout   GridLayout;
+#endif
+
+#endif // TECTO_GRIDLAYOUT_HPP
@@ -26,16 +26,61 @@
 ////////////////////////////////////////////////
 // Tecto library
 #include <Plate.hpp>
+#include <CrustMap.hpp>
+#include <OccupancyMap.hpp>
+#include <AtomicOccupancyMap.hpp>
+#include <PlateRasterizer.hpp>
+#include <Topology.hpp>
+#include <ThreadPool.hpp>
+#include <ScratchArena.hpp>
+#include <Random.hpp>
 ////////////////////////////////////////////////
 
 
 ////////////////////////////////////////////////
 // C++ Standard Library
 #include <vector>
+#include <utility>
+#include <functional>
 #include <cstdint>
 #include <memory>
+#include <atomic>
 ////////////////////////////////////////////////
 
+/*
+ * Payload decides which per-cell crust properties exist (see CrustPayload.hpp).
+ * Lithosphere is instantiated in Lithosphere.cpp for PreviewPayload,
+ * StandardPayload and ResearchPayload.
+ *
+ * Plates are only updated when one of their border crusts may have entered
+ * another cell. Each plate is kept in a priority queue by the earliest time
+ * that can happen, so plates that stand still or move slowly cost nothing
+ * on most ticks.
+ *
+ * The plates that are due move at the same time on a work-stealing pool
+ * that lives as long as the Lithosphere. A plate splits its own move into
+ * chunks of its border, so that a big plate keeps every thread busy rather
+ * than one. A plate only touches its own state when it moves and reports
+ * the cells its border has moved onto and left in its own lists.
+ *
+ * Those cells are then sorted into square tiles of the world and each tile
+ * is handled on its own thread. A cell move that reaches into another tile
+ * (a collision changes the cell the crust came from), and every move that
+ * shares a cell with it, is left for a second, serial pass. Each cell
+ * therefore sees its moves in the same order as if every plate was handled
+ * one at a time in plate order, so the outcome does not depend on the
+ * number of threads.
+ *
+ * Define TECTO_ATOMIC_OCCUPANCY to count occupancy in an AtomicOccupancyMap
+ * instead. A plate then claims and leaves its cells as soon as it has moved,
+ * on its own thread. The collisions it runs into and the cells that become
+ * empty are noted in one list per thread. Once every plate has moved, the
+ * collisions are sorted into tiles and solved like the cell moves above,
+ * and then the empty cells are filled. Only collisions need the tiles, but
+ * which of two plates collides on a cell depends on which gets there first,
+ * so the outcome may differ from run to run.
+ */
+template <class Payload>
 class Lithosphere
 {
     public:
@@ -66,34 +111,107 @@ class Lithosphere
 
         typedef std::unique_ptr<Plate> PlatePtr;
 
-                Lithosphere(unsigned int worldSizeX, unsigned int worldSizeY);
+                Lithosphere(unsigned int worldSizeX, unsigned int worldSizeY, uint64_t seed); // The same seed gives the same world.
 
         void    initializePlumes(sf::Vector2u worldSize);
         void    initializePlates(sf::Vector2u worldSize);
         void    initializeDrawMap();
 
         void    update(float years);
+        void    schedulePlate(std::size_t plate); // Call after changing the velocity of a plate.
         void    draw(sf::RenderWindow& window) const;
         void    drawPlumes(sf::RenderWindow& window) const;
 
 
-        void            solveCollision(BorderCrust* crust, int plateIndex);
+        void            solveCollision(Plate& plate, const CrustStep& step);
         void            populateEmptyIndex(sf::Vector2i index);
         void            handlePlateMovement();
         sf::Vector2i    fitIndexToHeightmap(sf::Vector2i index) const;
         void            registerFrontAndBackCrusts(std::vector<std::vector<BorderCrust*>>& frontCrusts, std::vector<sf::Vector2i>& backCrusts);
 
         const std::vector<PlatePtr>& getPlates() const;
+        const Random&                getRandom() const; // Numbers of the world seed.
+
+        // Height of every cell of the world, with each plate's crust where the plate is now.
+        const Grid<uint16_t>&   getSurface() const;
+        void                    setSampling(PlateRasterizer::Sampling sampling);
 
     private:
+        void    initializePlumeShapes();
+        void    tick(int64_t timeSteps); // In TIME_STEPS_PER_YEAR:ths of a year, at most MAX_WAIT.
+        void    refreshDrawMap();
+#ifdef TECTO_COUNT_ALLOCATIONS
+        std::size_t getBufferMemoryUsage() const; // In bytes, of the buffers a tick may grow.
+#endif // TECTO_COUNT_ALLOCATIONS
+
+        // A cell that the border of a plate has moved onto or left.
+        struct CellMove
+        {
+            CrustStep   mStep; // For a cell that was left, both indices are that cell and it has no source crust.
+            uint32_t    mPlate;
+            bool        mIsOnto;
+        };
+
+        void            applyMove(const CellMove& move);
+        template <class IsSerial, class Handle>
+        std::size_t     forEachTile(const CellMove* moves, std::size_t moveCount, IsSerial& isSerial, Handle& handle, CellMove* serialMoves);
+        void            leaveCell(sf::Vector2i index); // Notes the cell if it becomes empty.
+#ifdef TECTO_ATOMIC_OCCUPANCY
+        void            occupyCells(std::size_t plate);
+#endif // TECTO_ATOMIC_OCCUPANCY
+        std::size_t     getTile(sf::Vector2i index) const;
+        bool            isBoundaryCell(sf::Vector2i index) const;
+        void            setBoundaryCell(sf::Vector2i index, bool isBoundary);
+
+#ifdef TECTO_ATOMIC_OCCUPANCY
+        typedef AtomicOccupancyMap IndexOccupancyMap;
+#else
+        typedef OccupancyMap IndexOccupancyMap;
+#endif // TECTO_ATOMIC_OCCUPANCY
+
+        typedef std::pair<int64_t, std::size_t> ScheduledPlate; // Due time and plate index.
+        typedef std::vector<ScheduledPlate> Schedule; // Heap with the earliest due time at the front.
+
+        // A multiple of 64, so that no two tiles share a word of the occupancy map.
+        static const unsigned int TILE_SIZE = 64;
+
         std::vector<Plume>                  mPlumeTypes; // 0 = big, 1 = medium, 2 = small
         std::vector<std::unique_ptr<Plate>> mPlates;
-        std::vector<std::vector<Crust>>     mHeightmap;
+        CrustMap<Payload>                   mHeightmap;
         sf::VertexArray                     mDrawMap;
         sf::VertexArray                     mBorders; // TEMPORARY
         std::vector<Plume>                  mPlumes;
-        std::vector<std::vector<int8_t>>    mIndexOccupancyMap;
+        sf::VertexArray                     mPlumeShapes;
+        IndexOccupancyMap                   mIndexOccupancyMap;
         sf::Vector2u                        mSize;
+        Random                              mRandom;
+        Topology                            mTopology;
+        Grid<uint16_t>                      mSurface;
+        PlateRasterizer                     mRasterizer; // Draws moved plates into mSurface.
+
+        int64_t                             mTime; // In TIME_STEPS_PER_YEAR:ths of a year.
+        Schedule                            mSchedule;
+        std::vector<int64_t>                mDueTimes; // Time each plate is scheduled for. Other entries in mSchedule are stale.
+        std::vector<int64_t>                mUpdateTimes; // Time each plate was last updated.
+        std::vector<std::size_t>            mDuePlates; // Plates updated this tick, in ascending order.
+        ThreadPool                          mThreadPool; // Moves the due plates and handles the tiles.
+        ScratchArena                        mMovementArena; // Cell moves of one tick.
+        std::vector<uint64_t>               mBoundaryCells; // One bit per cell. Clear between ticks.
+        unsigned int                        mTileCountY;
+        std::size_t                         mTileCount;
+#ifdef TECTO_ATOMIC_OCCUPANCY
+        std::vector<std::vector<CellMove>>     mCollisions; // Found this tick, one list per thread.
+        std::vector<std::vector<sf::Vector2i>> mEmptyCells; // Cells that became empty this tick, one list per thread.
+#else
+        sf::Vector2i*                       mEmptyCells; // Cells that became empty this tick. Room for one per cell move.
+        std::atomic<std::size_t>            mEmptyCellCount;
+#endif // TECTO_ATOMIC_OCCUPANCY
+
+#ifdef TECTO_COUNT_ALLOCATIONS
+        unsigned int                        mTickCount;
+        std::size_t                         mAllocationCount;
+        std::size_t                         mBufferMemoryUsage; // getBufferMemoryUsage() after the last tick.
+#endif // TECTO_COUNT_ALLOCATIONS
 
 };
 
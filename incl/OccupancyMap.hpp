@@ -0,0 +1,110 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_OCCUPANCYMAP_HPP
+#define TECTO_OCCUPANCYMAP_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Counts how many crusts occupy each cell of the world.
+ *
+ * Every cell has a 2-bit counter that saturates at MAX_COUNT. The counters
+ * are bit-sliced: the low bits of all cells are stored in one bit plane and
+ * the high bits in another, so one 64-bit word holds one bit of 64 cells.
+ * This lets forEachCrowdedCell and forEachEmptyCell test 64 cells at a time.
+ *
+ * Cells are stored column by column and each column starts on a new word.
+ * The padding at the end of a column always has count 1, so it is never
+ * reported as crowded or empty. This layout does not change with
+ * TECTO_TILED_GRID: a word already holds 64 neighbouring cells.
+ */
+class OccupancyMap
+{
+    public:
+        static const unsigned int MAX_COUNT = 3;
+
+                        OccupancyMap(unsigned int sizeX, unsigned int sizeY, unsigned int count);
+
+        unsigned int    increment(unsigned int x, unsigned int y); // Returns the new count.
+        unsigned int    decrement(unsigned int x, unsigned int y); // Returns the new count.
+        unsigned int    getCount(unsigned int x, unsigned int y) const;
+        void            setCount(unsigned int x, unsigned int y, unsigned int count);
+
+        // Call function(x, y) for every cell with a count above 1.
+        template <typename Function>
+        void            forEachCrowdedCell(Function function) const;
+        // Call function(x, y) for every cell with a count of 0.
+        template <typename Function>
+        void            forEachEmptyCell(Function function) const;
+
+        std::size_t     getMemoryUsage() const; // In bytes.
+
+    private:
+        template <typename Function>
+        void            forEachSetBit(uint64_t word, std::size_t iWord, Function function) const;
+
+        unsigned int            mSizeX;
+        unsigned int            mSizeY;
+        std::size_t             mWordsPerColumn;
+        std::vector<uint64_t>   mLowBits;
+        std::vector<uint64_t>   mHighBits;
+};
+
+template <typename Function>
+void OccupancyMap::forEachCrowdedCell(Function function) const
+{
+    for(std::size_t i = 0; i < mHighBits.size(); i++)
+        if(mHighBits[i] != 0)
+            forEachSetBit(mHighBits[i], i, function);
+}
+
+template <typename Function>
+void OccupancyMap::forEachEmptyCell(Function function) const
+{
+    for(std::size_t i = 0; i < mLowBits.size(); i++)
+    {
+        uint64_t empty = ~(mLowBits[i] | mHighBits[i]);
+        if(empty != 0)
+            forEachSetBit(empty, i, function);
+    }
+}
+
+template <typename Function>
+void OccupancyMap::forEachSetBit(uint64_t word, std::size_t iWord, Function function) const
+{
+    unsigned int x = iWord / mWordsPerColumn;
+    unsigned int firstY = (iWord % mWordsPerColumn) * 64;
+    while(word != 0)
+    {
+        unsigned int bit = __builtin_ctzll(word);
+        function(x, firstY + bit);
+        word &= word - 1;
+    }
+}
+
+#endif // TECTO_OCCUPANCYMAP_HPP
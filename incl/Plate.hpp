@@ -25,12 +25,11 @@
 
 ////////////////////////////////////////////////
 // Tecto library
-#include <BorderCrust.hpp>
-////////////////////////////////////////////////
-
-////////////////////////////////////////////////
-// C++ Standard Library
-#include <list>
+#include <Border.hpp>
+#include <CellSet.hpp>
+#include <ScratchArena.hpp>
+#include <Topology.hpp>
+#include <ThreadPool.hpp>
 ////////////////////////////////////////////////
 
 ////////////////////////////////////////////////
@@ -43,52 +42,129 @@ namespace sf
     class RenderWindow;
 }
 
+// A cell that a border crust has moved onto, and the original index and source crust of the crust.
+struct CrustStep
+{
+    sf::Vector2i    mIndex;
+    sf::Vector2i    mOriginalIndex;
+    CrustHandle     mSourceCrust;
+};
+
 
 class Plate
 {
     public:
-                Plate(std::vector<std::vector<Crust>>& heightmap, sf::Vector2u worldSize, std::list<BorderCrust> border);
+        // Plates are moved in whole steps of time, so that the pose is exact
+        // however the years are split into updates.
+        static const int64_t TIME_STEPS_PER_YEAR = int64_t(1) << Fixed::FRACTION_BITS;
+
+                Plate(sf::Vector2u worldSize, const std::vector<BorderCrust>& border, const CellSet& cells);
 
-        void update(float years);
+        void update(int64_t timeSteps, ThreadPool& threadPool); // Splits the border into chunks on threadPool.
+        void resetScratch();
         void draw(sf::RenderWindow& window);
 
 
-        const std::vector<sf::Vector2i>&                            getOldCrustIndices() const;
-        const std::vector<BorderCrust*>&                            getNewCrustIndices() const;
+        const ScratchVector<sf::Vector2i>&                          getOldCrustIndices() const; // Cells the border has left.
+        const ScratchVector<CrustStep>&                             getNewCrustIndices() const; // Cells the border has moved onto.
+        Border&                                                     getBorder();
+        const Border&                                               getBorder() const;
 
         void                            setVelocity(float x, float y);
         sf::Vector2f                    getVelocity() const;
 
         void                            setRotationalVelocity(float degrees);
 
+        // No border crust can enter another cell before the plate has moved
+        // getCrossingMargin() cells, which takes at least margin / getMaxSpeed() years.
+        Coordinate                      getCrossingMargin() const;
+        Coordinate                      getMaxSpeed() const;
+
+        const sf::Transform&            getTransform() const;
+        sf::Vector2f                    getPosition(sf::Vector2i originalIndex) const;
+
+        // The pose in simulation numbers. A crust at original index i is at
+        // getRotationalCenter() + R * (i - getOrigin()), where R rotates by the
+        // angle whose sine and cosine are getSine() and getCosine().
+        const sf::Vector2<Coordinate>&  getOrigin() const;
+        const sf::Vector2<Coordinate>&  getRotationalCenter() const;
+        Coordinate                      getSine() const;
+        Coordinate                      getCosine() const;
+
+        // The original index of the plate point that has moved to the middle
+        // of the cell at index, i.e. the pose above undone.
+        sf::Vector2i                    getOriginalIndex(sf::Vector2i index) const;
+
         unsigned int getBorderCrustCount() const;
+
+        // The cells are original indices, which the plate keeps as it moves.
+        // Cells of the heightmap are mapped back through getOriginalIndex().
+        const CellSet&                  getCells() const;
+        unsigned int                    getCrustCount() const;
+        unsigned int                    getCrustCount(sf::Vector2i index) const; // index is a cell of the heightmap.
+        unsigned int                    getOverlap(const Plate& other) const; // Visits every cell of the plate.
+
+        std::size_t                     getMemoryUsage() const; // In bytes, scratch memory included.
+
     private:
         void                            drawBorder(sf::RenderWindow& window) const;
-        void                            move(sf::Vector2f distance);
-        void                            rotate(float degrees);
-        void                            moveBorder(sf::Vector2f distance, float degrees);
-        void updateBorder();
-        void                            fitIndexToWorldmap(sf::Vector2i& index);
-        void                            fitPositionToWorldmap(sf::Vector2f& pos);
-void loopCoords(sf::Vector2f& coords);
-void loopTranslation();
+#ifdef TECTO_FIXED_POINT
+        typedef sf::Vector2<Fixed>      Translation;
+        typedef Angle                   Rotation;
+        typedef Fixed                   RotationalVelocity;
+#else
+        typedef sf::Vector2<double>     Translation;
+        typedef double                  Rotation; // In degrees.
+        typedef float                   RotationalVelocity;
+#endif // TECTO_FIXED_POINT
+
+        void                            advance(int64_t timeSteps);
+#ifndef TECTO_FIXED_POINT
+        void                            restartMotion(); // Call before the velocity changes.
+#endif // TECTO_FIXED_POINT
+        void                            updatePose(ThreadPool* threadPool); // Serial without a pool.
+        void                            updateNormals();
+        void updateBorder(ThreadPool& threadPool);
+        void                            closeGaps();
+        void                            addGapCrusts(std::size_t from, sf::Vector2i delta, std::size_t position, Border::Insertion* insertions, std::size_t& insertionCount) const;
 void initializeDrawMap();
+        void                            updateCrossingMargin();
+        sf::Vector2i                    getIndex(sf::Vector2i originalIndex) const; // Inverse of getOriginalIndex().
 
-        sf::Vector2i                    mWorldSize; // Defined as signed int vector to prevent type conversion in Plate::fitIndexToWorldmap.
-        sf::Vector2f                    mWorldSizef;
-        std::vector<std::vector<Crust>>& mHeightmap;
+        sf::Vector2i                    mWorldSize;
+        Topology                        mTopology;
         sf::VertexArray                 mDrawMap;
         //std::deque<std::deque<Crust>>   mHeightmap;// Two-dimensional deque (for efficient insertion/deletion at both ends) containing all Pixels belonging to Plate. To retain intuitive element access, i.e. mHeightmap[x][y] instead of mHeightmap[y][x], it contains deques containing Crusts ordered in ascending Y-position.
-        std::list<BorderCrust>          mBorder; // Store pointers to the outermost Crusts of Plate's mHeightmap.
-        sf::Vector2f                    mVelocity;
-        sf::Vector2f                    mTranslation; // How many indices the Plate has moved from its original position.
-        float                           mRotation; // How many degrees the plate has rotated.
-        float                           mRotationalVelocity; // How many degrees per tick the plate is rotating.
-        sf::Vector2f                    mRotationalCenter;
-        sf::Transform                   mTransform;
-
-        std::vector<BorderCrust*>       mNewCrustIndices;
-        std::vector<sf::Vector2i>       mOldCrustIndices;
+        Border                          mBorder; // The outermost Crusts of Plate's mHeightmap.
+        CellSet                         mCells; // Original index of every crust of the plate, border included.
+        sf::Vector2<Coordinate>         mVelocity;
+        Translation                     mTranslation; // How many indices the Plate has moved from its original position.
+        Rotation                        mRotation; // How far the plate has rotated.
+        Rotation                        mNormalRotation; // mRotation when the border normals were last updated.
+        RotationalVelocity              mRotationalVelocity; // How many degrees per year the plate is rotating.
+#ifdef TECTO_FIXED_POINT
+        // The sums of velocity times time steps, i.e. the pose in 2^-32:ths of
+        // a cell and of a degree. Whole turns are left out.
+        sf::Vector2<int64_t>            mDistance;
+        int64_t                         mTurn;
+#else
+        Translation                     mStartTranslation; // Pose when the velocity was last set.
+        Rotation                        mStartRotation;
+        int64_t                         mMotionTimeSteps; // Time moved since then.
+#endif // TECTO_FIXED_POINT
+        sf::Vector2<Coordinate>         mOrigin; // Rotational center at the start, in original indices.
+        sf::Vector2<Coordinate>         mRotationalCenter; // mOrigin moved by mTranslation.
+        Coordinate                      mCrossingMargin; // Distance any crust can move before it enters another cell.
+        Coordinate                      mMaxRadius; // Longest radius vector, measured as |x| + |y|.
+        Coordinate                      mSine; // Of mRotation.
+        Coordinate                      mCosine;
+        sf::Transform                   mTransform; // From original indices to current positions.
+
+        sf::VertexArray                 mRotationalCenterMarker;
+
+        ScratchArena                    mArena; // Memory for buffers that only live for one tick.
+        ScratchVector<CrustStep>        mNewCrustIndices;
+        ScratchVector<sf::Vector2i>     mOldCrustIndices;
 };
 
 #endif // TECTO_PLATE_HPP
@@ -0,0 +1,139 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_PLATERASTERIZER_HPP
+#define TECTO_PLATERASTERIZER_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Plate.hpp>
+#include <Grid.hpp>
+#include <ScratchArena.hpp>
+#include <ThreadPool.hpp>
+#include <Topology.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Draws the crust of whole plates, not only their borders, into a world grid.
+ *
+ * A plate's crust never moves in memory: it stays at its original indices
+ * in the source grid. For every world cell inside the plate's border the
+ * plate's pose is inverted to find which original index is there now, and
+ * that crust is sampled, either the nearest cell or bilinearly between the
+ * four closest.
+ *
+ * The inside of the border is filled one world column at a time between the
+ * points where the border polygon crosses the column. Columns are walked in
+ * BLOCK_SIZE x BLOCK_SIZE blocks, so that both the cells written and the
+ * rotated source cells read stay in cache. Within a span the source position
+ * is stepped by a constant in integer arithmetic, so a cell costs one
+ * sample and one write. Given a thread pool, blocks of columns are filled at
+ * the same time.
+ *
+ * The spans of each plate are kept until it is drawn again. Its old cells
+ * that no other plate has drawn over since are then cleared to 0, so a
+ * moving plate leaves no trail. Every span cleared or drawn is also listed
+ * in getDirtySpans() until clearDirtySpans(), for whoever shows the grid.
+ */
+class PlateRasterizer
+{
+    public:
+        enum Sampling
+        {
+            Nearest,
+            Bilinear,
+        };
+
+        // Cells mFirstY to mLastY of column mX, not wrapped to the world.
+        struct Span
+        {
+            int mX;
+            int mFirstY;
+            int mLastY;
+        };
+
+                    PlateRasterizer(sf::Vector2i worldSize, Sampling sampling = Nearest);
+
+        // The same plate index must be given every time a plate is drawn.
+        void        rasterize(std::size_t plateIndex, const Plate& plate, const Grid<uint16_t>& source, Grid<uint16_t>& target, ThreadPool* threadPool); // Serial without a pool.
+
+        const std::vector<Span>& getDirtySpans() const;
+        void        clearDirtySpans();
+
+        // Call function(x, y) for every cell of span, wrapped to the world.
+        template <typename Function>
+        void        forEachCell(const Span& span, Function function) const;
+
+        void        setSampling(Sampling sampling);
+        Sampling    getSampling() const;
+
+        std::size_t getMemoryUsage() const; // In bytes, not counting the world grid of owners.
+
+    private:
+        static const int BLOCK_SIZE = 64;
+
+        void        clearFootprint(std::vector<Span>& footprint, Grid<uint16_t>& target);
+        void        findCrossings(const Plate& plate);
+        void        collectSpans(std::vector<Span>& spans) const;
+        bool        clipSpan(Span& span) const; // False if no cell of span is in the world.
+        template <bool BILINEAR>
+        void        fillSpans(const Plate& plate, const Grid<uint16_t>& source, Grid<uint16_t>& target, ThreadPool* threadPool);
+        template <bool BILINEAR>
+        void        fillSegment(const Plate& plate, const Grid<uint16_t>& source, Grid<uint16_t>& target, const Span& span);
+        template <bool BILINEAR>
+        uint16_t    sample(const Grid<uint16_t>& source, int64_t x, int64_t y) const; // Position in 32.32 fixed point.
+
+        Topology        mTopology;
+        Sampling        mSampling;
+        ScratchArena    mArena; // Span buffers of the plate being drawn.
+        int             mFirstColumn;
+        int             mColumnCount;
+        uint32_t*       mCrossingOffsets; // Crossings of column i are [mCrossingOffsets[i], mCrossingOffsets[i + 1]).
+        Coordinate*     mCrossings; // Y of every crossing, sorted within each column.
+        uint16_t        mPlate; // Index of the plate being drawn.
+        Grid<uint16_t>  mOwners; // Index of the plate that last drew each cell.
+        std::vector<std::vector<Span>> mFootprints; // Spans of each plate when it was last drawn, border cells included.
+        std::vector<Span> mDirtySpans;
+};
+
+template <typename Function>
+void PlateRasterizer::forEachCell(const Span& span, Function function) const
+{
+    sf::Vector2i worldSize = mTopology.getSize();
+    int x = wrapCoordinate(span.mX, worldSize.x);
+    int y = wrapCoordinate(span.mFirstY, worldSize.y);
+    for(int i = span.mFirstY; i <= span.mLastY; i++)
+    {
+        function(x, y);
+        y++;
+        y = y < worldSize.y ? y : 0;
+    }
+}
+
+#endif // TECTO_PLATERASTERIZER_HPP
@@ -0,0 +1,58 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_RANDOM_HPP
+#define TECTO_RANDOM_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstdint>
+////////////////////////////////////////////////
+
+/*
+ * Counter-based random numbers (Philox4x32-10).
+ *
+ * Every number is a function of the world seed, a stream and a counter, and
+ * of nothing else. There is no state to share or advance, so any thread can
+ * draw the numbers of plume i or cell (x, y) on its own and gets the same
+ * numbers at any thread count and in any order. Give every kind of use its
+ * own stream, and every draw within it its own counter.
+ *
+ * The same seed gives the same numbers on every platform.
+ */
+class Random
+{
+    public:
+        explicit        Random(uint64_t seed);
+
+        uint32_t        get(uint64_t stream, uint64_t counter) const;
+        uint32_t        get(uint64_t stream, uint64_t counter, uint32_t bound) const; // Below bound, which must be positive.
+        float           getFloat(uint64_t stream, uint64_t counter) const; // In [0, 1).
+
+        uint64_t        getSeed() const;
+
+    private:
+        uint64_t        mSeed;
+};
+
+#endif // TECTO_RANDOM_HPP
@@ -0,0 +1,71 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_ROTATIONKERNEL_HPP
+#define TECTO_ROTATIONKERNEL_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Fixed.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Rotation of many points at once, stored as separate x and y arrays.
+ *
+ * Every point is rotated around the origin by the angle whose sine and
+ * cosine are s and c, and written to rotatedX and rotatedY:
+ *     x' = x * c - y * s
+ *     y' = x * s + y * c
+ * The output arrays may be the input arrays.
+ *
+ * rotatePoints() picks the widest kernel the CPU supports the first time it
+ * is called: AVX (8 points per instruction), SSE2 (4 points) or plain C++.
+ * All kernels do the same float operations in the same order without fused
+ * multiply-add, so they give bit-identical results.
+ *
+ * The Fixed overload is plain integer arithmetic, which the compiler
+ * vectorizes by itself. Each coordinate is rounded once, towards negative
+ * infinity.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define TECTO_X86
+#endif
+
+typedef void (*RotationKernel)(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c);
+
+void            rotatePoints(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c);
+void            rotatePoints(const Fixed* x, const Fixed* y, Fixed* rotatedX, Fixed* rotatedY, std::size_t count, Fixed s, Fixed c);
+RotationKernel  getRotationKernel(); // Fastest kernel supported by the CPU.
+
+void            rotatePointsScalar(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c);
+#ifdef TECTO_X86
+void            rotatePointsSSE2(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c);
+void            rotatePointsAVX(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c);
+#endif // TECTO_X86
+
+#endif // TECTO_ROTATIONKERNEL_HPP
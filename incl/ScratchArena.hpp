@@ -0,0 +1,190 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_SCRATCHARENA_HPP
+#define TECTO_SCRATCHARENA_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cassert>
+////////////////////////////////////////////////
+
+/*
+ * Bump allocator for buffers that only live for one tick.
+ *
+ * Memory is handed out from one block and is all given back at once by
+ * reset(). If a tick asks for more than the block holds, the rest is taken
+ * from the heap and the block is grown at the next reset, so after a few
+ * ticks the arena no longer touches the heap.
+ */
+class ScratchArena
+{
+    public:
+        explicit        ScratchArena(std::size_t capacity = 0);
+
+        template <class T>
+        T*              allocate(std::size_t count);
+        void            reset();
+
+        std::size_t     getCapacity() const;
+        std::size_t     getMemoryUsage() const; // In bytes, what this tick took from the heap included.
+
+    private:
+        void*           allocateBytes(std::size_t bytes, std::size_t alignment);
+
+        std::unique_ptr<char[]>                 mBlock;
+        std::size_t                             mCapacity;
+        std::size_t                             mUsed;
+        std::vector<std::unique_ptr<char[]>>    mOverflow;
+        std::size_t                             mOverflowBytes;
+};
+
+template <class T>
+T* ScratchArena::allocate(std::size_t count)
+{
+    return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+}
+
+
+/*
+ * Fixed-capacity array whose memory comes from a ScratchArena.
+ *
+ * Elements are never destroyed, so T should be a plain value type. The
+ * array must be allocated again (or cleared) after the arena is reset.
+ */
+template <class T>
+class ScratchVector
+{
+    public:
+                    ScratchVector();
+
+        void        allocate(ScratchArena& arena, std::size_t capacity);
+        void        clear();
+        void        push_back(const T& value);
+        void        resize(std::size_t size); // Up to the capacity. New elements are left as they are.
+
+        std::size_t size() const;
+        bool        empty() const;
+        T&          operator[](std::size_t i);
+        const T&    operator[](std::size_t i) const;
+        T*          begin();
+        T*          end();
+        const T*    begin() const;
+        const T*    end() const;
+
+    private:
+        T*          mData;
+        std::size_t mSize;
+        std::size_t mCapacity;
+};
+
+template <class T>
+ScratchVector<T>::ScratchVector()
+: mData(nullptr)
+, mSize(0)
+, mCapacity(0)
+{
+}
+
+template <class T>
+void ScratchVector<T>::allocate(ScratchArena& arena, std::size_t capacity)
+{
+    mData = arena.allocate<T>(capacity);
+    mSize = 0;
+    mCapacity = capacity;
+}
+
+// Forget the elements and the memory. Call when the arena is reset.
+template <class T>
+void ScratchVector<T>::clear()
+{
+    mData = nullptr;
+    mSize = 0;
+    mCapacity = 0;
+}
+
+template <class T>
+void ScratchVector<T>::push_back(const T& value)
+{
+    assert(mSize < mCapacity);
+    mData[mSize++] = value;
+}
+
+template <class T>
+void ScratchVector<T>::resize(std::size_t size)
+{
+    assert(size <= mCapacity);
+    mSize = size;
+}
+
+template <class T>
+std::size_t ScratchVector<T>::size() const
+{
+    return mSize;
+}
+
+template <class T>
+bool ScratchVector<T>::empty() const
+{
+    return mSize == 0;
+}
+
+template <class T>
+T& ScratchVector<T>::operator[](std::size_t i)
+{
+    return mData[i];
+}
+
+template <class T>
+const T& ScratchVector<T>::operator[](std::size_t i) const
+{
+    return mData[i];
+}
+
+template <class T>
+T* ScratchVector<T>::begin()
+{
+    return mData;
+}
+
+template <class T>
+T* ScratchVector<T>::end()
+{
+    return mData + mSize;
+}
+
+template <class T>
+const T* ScratchVector<T>::begin() const
+{
+    return mData;
+}
+
+template <class T>
+const T* ScratchVector<T>::end() const
+{
+    return mData + mSize;
+}
+
+#endif // TECTO_SCRATCHARENA_HPP
@@ -0,0 +1,98 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef TECTO_SPLICE_HPP
+#define TECTO_SPLICE_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <algorithm>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * In-place splicing of sequences.
+ *
+ * A splice is a list of runs sorted by position. Each run erases
+ * mEraseCount elements from mPosition on and puts mInsertCount new elements
+ * in their place. At least one kept element lies between two runs.
+ *
+ * The kept elements between two runs form a block that moves as a whole.
+ * shiftKeptBlocks() hands every block that has to move to
+ * move(begin, end, shift), where [begin, end) are the positions of the block
+ * before the splice. Blocks that move towards the front come first, front
+ * to back, and then blocks that move towards the back, back to front, so no
+ * block lands on one that has not moved yet. The sequence must already have
+ * room for max(size, getSplicedSize()) elements.
+ */
+struct SpliceRun
+{
+    std::size_t mPosition;
+    std::size_t mEraseCount;
+    std::size_t mInsertCount;
+};
+
+inline std::size_t getSplicedSize(std::size_t size, const SpliceRun* runs, std::size_t runCount)
+{
+    for(std::size_t i = 0; i < runCount; i++)
+        size = size - runs[i].mEraseCount + runs[i].mInsertCount;
+
+    return size;
+}
+
+template <class Move>
+void shiftKeptBlocks(std::size_t size, const SpliceRun* runs, std::size_t runCount, Move move)
+{
+    // The block after run i moves as far as the runs up to i grow the sequence.
+    std::ptrdiff_t shift = 0;
+    for(std::size_t i = 0; i < runCount; i++)
+    {
+        shift += std::ptrdiff_t(runs[i].mInsertCount) - std::ptrdiff_t(runs[i].mEraseCount);
+        std::size_t begin = runs[i].mPosition + runs[i].mEraseCount;
+        std::size_t end = i + 1 < runCount ? runs[i + 1].mPosition : size;
+        if(shift < 0 && begin < end)
+            move(begin, end, shift);
+    }
+
+    for(std::size_t i = runCount; i-- > 0;)
+    {
+        std::size_t begin = runs[i].mPosition + runs[i].mEraseCount;
+        std::size_t end = i + 1 < runCount ? runs[i + 1].mPosition : size;
+        if(shift > 0 && begin < end)
+            move(begin, end, shift);
+
+        shift -= std::ptrdiff_t(runs[i].mInsertCount) - std::ptrdiff_t(runs[i].mEraseCount);
+    }
+}
+
+// Move the elements [begin, end) of data shift steps, in the order
+// shiftKeptBlocks() needs.
+template <class T>
+void shiftBlock(T* data, std::size_t begin, std::size_t end, std::ptrdiff_t shift)
+{
+    if(shift < 0)
+        std::copy(data + begin, data + end, data + begin + shift);
+    else
+        std::copy_backward(data + begin, data + end, data + end + shift);
+}
+
+#endif // TECTO_SPLICE_HPP
@@ -0,0 +1,135 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_THREADPOOL_HPP
+#define TECTO_THREADPOOL_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+////////////////////////////////////////////////
+
+/*
+ * Work-stealing threads that stay alive between ticks and share out loops.
+ *
+ * forEach calls a function once for every index of a loop, spread over the
+ * worker threads and the calling thread, and returns when every call has
+ * returned. The function is not copied or stored, so a loop does not
+ * allocate.
+ *
+ * Every thread has its own deque of index ranges. A thread splits the range
+ * it is about to run in halves, keeps the lower half and pushes the upper
+ * half to the back of its deque, until a single index is left. It then takes
+ * work from the back of its own deque, and when that is empty steals from
+ * the front of another thread's deque, where the biggest ranges are.
+ *
+ * forEach may be called from inside a loop. The inner indices go to the
+ * deque of the calling thread, where idle threads can steal them, and the
+ * calling thread runs other work while it waits for them. A big task can
+ * thus split itself, for example a plate over chunks of its border, without
+ * keeping the other threads waiting.
+ *
+ * Calls for different indices may run at the same time and in any order.
+ * They must not touch the same data unless it is made for that.
+ */
+class ThreadPool
+{
+    public:
+        explicit        ThreadPool(unsigned int threadCount = getDefaultThreadCount()); // Including the calling thread.
+                        ~ThreadPool();
+
+                        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool&     operator=(const ThreadPool&) = delete;
+
+        template <class Function>
+        void            forEach(std::size_t count, Function& function);
+
+        unsigned int    getThreadCount() const;
+        std::size_t     getThreadIndex() const; // Below getThreadCount(). 0 for threads outside the pool.
+        static unsigned int getDefaultThreadCount(); // One per hardware thread.
+
+    private:
+        typedef void (*Call)(void* function, std::size_t index);
+
+        // The indices [mBegin, mEnd) of a loop.
+        struct Task
+        {
+            Call                        mCall;
+            void*                       mFunction;
+            std::size_t                 mBegin;
+            std::size_t                 mEnd;
+            std::atomic<std::size_t>*   mPendingCount; // Indices of the loop that have not returned.
+        };
+
+        // A deque never holds more than a few ranges per loop, as they halve
+        // in size. Should it fill up, the rest of a range is run unsplit.
+        static const std::size_t DEQUE_CAPACITY = 256;
+
+        struct Deque
+        {
+            std::mutex  mMutex;
+            Task        mTasks[DEQUE_CAPACITY];
+            std::size_t mFront; // Positions grow without bound and wrap around mTasks.
+            std::size_t mBack;
+        };
+
+        template <class Function>
+        static void     invoke(void* function, std::size_t index);
+
+        void            run(Call call, void* function, std::size_t count);
+        void            runTask(Task task);
+        bool            runOtherTask(); // Returns false if there was nothing to run.
+        bool            push(const Task& task);
+        bool            pop(Task& task);
+        bool            steal(Task& task);
+        void            work(std::size_t threadIndex);
+
+        std::vector<std::unique_ptr<Deque>> mDeques; // One per thread, the calling thread's first.
+        std::vector<std::thread>            mWorkers;
+        std::atomic<std::size_t>            mQueuedCount; // Tasks in all deques.
+
+        std::mutex                          mMutex;
+        std::condition_variable             mWakeUp;
+        std::atomic<unsigned int>           mSleepingCount;
+        bool                                mIsStopping;
+};
+
+template <class Function>
+void ThreadPool::forEach(std::size_t count, Function& function)
+{
+    run(&ThreadPool::invoke<Function>, &function, count);
+}
+
+template <class Function>
+void ThreadPool::invoke(void* function, std::size_t index)
+{
+    (*static_cast<Function*>(function))(index);
+}
+
+#endif // TECTO_THREADPOOL_HPP
@@ -0,0 +1,280 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef TECTO_TOPOLOGY_HPP
+#define TECTO_TOPOLOGY_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Fixed.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// Super Fast Media Library (SFML)
+#include <SFML/System/Vector2.hpp>
+////////////////////////////////////////////////
+
+/*
+ * A topology decides what happens at the edges of the world.
+ *
+ * Every topology provides:
+ * - wrapIndex and wrapPosition, which bring an index or position that has
+ *   left the world back into it,
+ * - wrapTranslation, which shaves whole turns around the world off a
+ *   translation,
+ * - getDelta, the shortest step from one index to another,
+ * - WRAPS_X and WRAPS_Y, whether each axis wraps around.
+ *
+ * Indices and positions may be at most one world size outside the world.
+ * Everything is branchless, so loops over the border do not pay for
+ * mispredictions at the edges of the world. Positions and translations can
+ * be float, double or Fixed.
+ */
+
+// Bring value in [-size, 2 * size) into [0, size).
+inline int wrapCoordinate(int value, int size)
+{
+    value += size & -int(value < 0);
+    value -= size & -int(value >= size);
+    return value;
+}
+
+inline float wrapCoordinate(float value, float size)
+{
+    value += size * (value < 0.f);
+    value -= size * (value >= size);
+    return value;
+}
+
+inline Fixed wrapCoordinate(Fixed value, Fixed size)
+{
+    return Fixed::fromRaw(wrapCoordinate(value.getRaw(), size.getRaw()));
+}
+
+// Bring value into [0, size).
+inline float clampCoordinate(float value, float size)
+{
+    return std::min(std::max(value, 0.f), std::nextafter(size, 0.f));
+}
+
+inline Fixed clampCoordinate(Fixed value, Fixed size)
+{
+    return Fixed::fromRaw(std::min(std::max(value.getRaw(), 0), size.getRaw() - 1));
+}
+
+// Remove whole multiples of size from value. std::fmod is exact.
+inline double removeTurns(double value, int size)
+{
+    return std::fmod(value, size);
+}
+
+inline Fixed removeTurns(Fixed value, int size)
+{
+    // Fixed(size) would overflow for sizes of 32768 and up. The remainder is
+    // smaller than value, so it fits again.
+    return Fixed::fromRaw(int32_t(int64_t(value.getRaw()) % (int64_t(size) << Fixed::FRACTION_BITS)));
+}
+
+// Bring delta in [-size, size] into [-size / 2, size / 2].
+inline int shortenDelta(int delta, int size)
+{
+    delta -= size & -int(delta > size / 2);
+    delta += size & -int(delta < -size / 2);
+    return delta;
+}
+
+/*
+ * Each axis either wraps around or is bounded. A bounded axis clamps
+ * indices and positions to the world.
+ */
+template <bool WRAP_X, bool WRAP_Y>
+class WorldTopology
+{
+    public:
+        static const bool       WRAPS_X = WRAP_X;
+        static const bool       WRAPS_Y = WRAP_Y;
+
+                                WorldTopology(sf::Vector2i worldSize);
+
+        sf::Vector2i            wrapIndex(sf::Vector2i index) const;
+        template <class T>
+        sf::Vector2<T>          wrapPosition(sf::Vector2<T> position) const;
+        template <class T>
+        sf::Vector2<T>          wrapTranslation(sf::Vector2<T> translation) const;
+        sf::Vector2i            getDelta(sf::Vector2i from, sf::Vector2i to) const;
+
+        sf::Vector2i            getSize() const;
+
+    private:
+        sf::Vector2i            mSize;
+};
+
+// Wraps around on both axes.
+typedef WorldTopology<true, true>   TorusTopology;
+// Wraps around east to west but not over the poles.
+typedef WorldTopology<true, false>  HorizontalCylinderTopology;
+// Has edges all around.
+typedef WorldTopology<false, false> BoundedTopology;
+
+/*
+ * Torus whose sides are powers of two, so that wrapping an index is a mask.
+ */
+class PowerOfTwoTorusTopology
+{
+    public:
+        static const bool       WRAPS_X = true;
+        static const bool       WRAPS_Y = true;
+
+                                PowerOfTwoTorusTopology(sf::Vector2i worldSize);
+
+        sf::Vector2i            wrapIndex(sf::Vector2i index) const;
+        template <class T>
+        sf::Vector2<T>          wrapPosition(sf::Vector2<T> position) const;
+        template <class T>
+        sf::Vector2<T>          wrapTranslation(sf::Vector2<T> translation) const;
+        sf::Vector2i            getDelta(sf::Vector2i from, sf::Vector2i to) const;
+
+        sf::Vector2i            getSize() const;
+
+    private:
+        sf::Vector2i            mSize;
+        sf::Vector2i            mMask;
+};
+
+
+template <bool WRAP_X, bool WRAP_Y>
+WorldTopology<WRAP_X, WRAP_Y>::WorldTopology(sf::Vector2i worldSize)
+: mSize(worldSize)
+{
+}
+
+template <bool WRAP_X, bool WRAP_Y>
+sf::Vector2i WorldTopology<WRAP_X, WRAP_Y>::wrapIndex(sf::Vector2i index) const
+{
+    assert(index.x >= -mSize.x && index.x < 2 * mSize.x);
+    assert(index.y >= -mSize.y && index.y < 2 * mSize.y);
+
+    index.x = WRAP_X ? wrapCoordinate(index.x, mSize.x) : std::min(std::max(index.x, 0), mSize.x - 1);
+    index.y = WRAP_Y ? wrapCoordinate(index.y, mSize.y) : std::min(std::max(index.y, 0), mSize.y - 1);
+    return index;
+}
+
+template <bool WRAP_X, bool WRAP_Y> template <class T>
+sf::Vector2<T> WorldTopology<WRAP_X, WRAP_Y>::wrapPosition(sf::Vector2<T> position) const
+{
+    T sizeX = T(mSize.x);
+    T sizeY = T(mSize.y);
+    position.x = WRAP_X ? wrapCoordinate(position.x, sizeX) : clampCoordinate(position.x, sizeX);
+    position.y = WRAP_Y ? wrapCoordinate(position.y, sizeY) : clampCoordinate(position.y, sizeY);
+    return position;
+}
+
+template <bool WRAP_X, bool WRAP_Y> template <class T>
+sf::Vector2<T> WorldTopology<WRAP_X, WRAP_Y>::wrapTranslation(sf::Vector2<T> translation) const
+{
+    if(WRAP_X)
+        translation.x = removeTurns(translation.x, mSize.x);
+    if(WRAP_Y)
+        translation.y = removeTurns(translation.y, mSize.y);
+
+    return translation;
+}
+
+template <bool WRAP_X, bool WRAP_Y>
+sf::Vector2i WorldTopology<WRAP_X, WRAP_Y>::getDelta(sf::Vector2i from, sf::Vector2i to) const
+{
+    sf::Vector2i delta = to - from;
+    if(WRAP_X)
+        delta.x = shortenDelta(delta.x, mSize.x);
+    if(WRAP_Y)
+        delta.y = shortenDelta(delta.y, mSize.y);
+
+    return delta;
+}
+
+template <bool WRAP_X, bool WRAP_Y>
+sf::Vector2i WorldTopology<WRAP_X, WRAP_Y>::getSize() const
+{
+    return mSize;
+}
+
+
+inline PowerOfTwoTorusTopology::PowerOfTwoTorusTopology(sf::Vector2i worldSize)
+: mSize(worldSize)
+, mMask(worldSize.x - 1, worldSize.y - 1)
+{
+    assert(worldSize.x > 0 && (worldSize.x & mMask.x) == 0);
+    assert(worldSize.y > 0 && (worldSize.y & mMask.y) == 0);
+}
+
+inline sf::Vector2i PowerOfTwoTorusTopology::wrapIndex(sf::Vector2i index) const
+{
+    return sf::Vector2i(index.x & mMask.x, index.y & mMask.y);
+}
+
+template <class T>
+sf::Vector2<T> PowerOfTwoTorusTopology::wrapPosition(sf::Vector2<T> position) const
+{
+    return sf::Vector2<T>(wrapCoordinate(position.x, T(mSize.x)), wrapCoordinate(position.y, T(mSize.y)));
+}
+
+template <class T>
+sf::Vector2<T> PowerOfTwoTorusTopology::wrapTranslation(sf::Vector2<T> translation) const
+{
+    return sf::Vector2<T>(removeTurns(translation.x, mSize.x), removeTurns(translation.y, mSize.y));
+}
+
+// The delta is taken modulo the size and recentered around zero.
+inline sf::Vector2i PowerOfTwoTorusTopology::getDelta(sf::Vector2i from, sf::Vector2i to) const
+{
+    sf::Vector2i half(mSize.x / 2, mSize.y / 2);
+    sf::Vector2i delta = to - from + half;
+    return sf::Vector2i((delta.x & mMask.x) - half.x, (delta.y & mMask.y) - half.y);
+}
+
+inline sf::Vector2i PowerOfTwoTorusTopology::getSize() const
+{
+    return mSize;
+}
+
+
+// Topology of the world. The default is a torus.
+// Define TECTO_CYLINDER_WORLD, TECTO_BOUNDED_WORLD or TECTO_POWER_OF_TWO_WORLD to change it.
+#if defined(TECTO_CYLINDER_WORLD)
+typedef HorizontalCylinderTopology  Topology;
+#elif defined(TECTO_BOUNDED_WORLD)
+typedef BoundedTopology             Topology;
+#elif defined(TECTO_POWER_OF_TWO_WORLD)
+typedef PowerOfTwoTorusTopology     Topology;
+#else
+typedef TorusTopology               Topology;
+#endif
+
+#endif // TECTO_TOPOLOGY_HPP
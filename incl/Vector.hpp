@@ -20,291 +20,468 @@
 ****************************************************************
 ****************************************************************/
 
-#ifndef VECTOR_H
-#define VECTOR_H
-
-
+#ifndef TECTO_VECTOR_HPP
+#define TECTO_VECTOR_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstddef>
+#include <cassert>
+////////////////////////////////////////////////
+
+/*
+ * Two-dimensional vector of any arithmetic type, Fixed included.
+ *
+ * Every operator works component-wise, with another vector or with a
+ * scalar that applies to both components. Operators that do not change the
+ * vector are constexpr, so sizes and offsets can be worked out at compile
+ * time. Nothing here depends on SFML; convert at the edges of the engine.
+ */
 template <class T>
 struct Vector
 {
-    Vector();
-    Vector(T xParam, T yParam);
-
-
-    template <typename OperationType>
-    Vector operator + (const Vector<OperationType>& b);
-    template <typename OperationType>
-    Vector operator + (const OperationType& b);
-
-    template <typename OperationType>
-    Vector operator - (const Vector<OperationType>& b);
-    template <typename OperationType>
-    Vector operator - (const OperationType& b);
-
-    template <typename OperationType>
-    Vector operator * (const Vector<OperationType>& b);
-    template <typename OperationType>
-    Vector operator * (const OperationType& b);
-
-    template <typename OperationType>
-    Vector operator / (const Vector<OperationType>& b);
-    template <typename OperationType>
-    Vector operator / (const OperationType& b);
-
-    template <typename OperationType>
-    Vector operator % (const Vector<OperationType>& b);
-    template <typename OperationType>
-    Vector operator % (const OperationType& b);
+    typedef T Scalar;
+
+    constexpr                       Vector();
+    constexpr                       Vector(T xParam, T yParam);
+    template <class U>
+    constexpr explicit              Vector(const Vector<U>& other);
+
+    Vector&                         operator+=(const Vector& b);
+    Vector&                         operator-=(const Vector& b);
+    Vector&                         operator*=(const Vector& b);
+    Vector&                         operator/=(const Vector& b);
+    Vector&                         operator%=(const Vector& b);
+    Vector&                         operator+=(T b);
+    Vector&                         operator-=(T b);
+    Vector&                         operator*=(T b);
+    Vector&                         operator/=(T b);
+    Vector&                         operator%=(T b);
+
+    // The scalar is not deduced, so wSize * 4 works for an unsigned wSize.
+    friend constexpr Vector         operator-(const Vector& a)                   { return Vector(-a.x, -a.y); }
+    friend constexpr Vector         operator+(const Vector& a, const Vector& b)  { return Vector(a.x + b.x, a.y + b.y); }
+    friend constexpr Vector         operator-(const Vector& a, const Vector& b)  { return Vector(a.x - b.x, a.y - b.y); }
+    friend constexpr Vector         operator*(const Vector& a, const Vector& b)  { return Vector(a.x * b.x, a.y * b.y); }
+    friend constexpr Vector         operator/(const Vector& a, const Vector& b)  { return Vector(a.x / b.x, a.y / b.y); }
+    friend constexpr Vector         operator%(const Vector& a, const Vector& b)  { return Vector(a.x % b.x, a.y % b.y); }
+    friend constexpr Vector         operator+(const Vector& a, T b)              { return Vector(a.x + b, a.y + b); }
+    friend constexpr Vector         operator-(const Vector& a, T b)              { return Vector(a.x - b, a.y - b); }
+    friend constexpr Vector         operator*(const Vector& a, T b)              { return Vector(a.x * b, a.y * b); }
+    friend constexpr Vector         operator/(const Vector& a, T b)              { return Vector(a.x / b, a.y / b); }
+    friend constexpr Vector         operator%(const Vector& a, T b)              { return Vector(a.x % b, a.y % b); }
+    friend constexpr Vector         operator*(T a, const Vector& b)              { return Vector(a * b.x, a * b.y); }
+    friend constexpr bool           operator==(const Vector& a, const Vector& b) { return a.x == b.x && a.y == b.y; }
+    friend constexpr bool           operator!=(const Vector& a, const Vector& b) { return a.x != b.x || a.y != b.y; }
 
-    template <typename OperationType>
-    void operator = (const Vector<OperationType>& b);
-    template <typename OperationType>
-    void operator = (const OperationType& b);
+    T x;
+    T y;
+};
 
+template <class T>
+constexpr T dot(const Vector<T>& a, const Vector<T>& b)
+{
+    return a.x * b.x + a.y * b.y;
+}
 
-    template <typename OperationType>
-    bool operator == (const Vector<OperationType>& b);
-    template <typename OperationType>
-    bool operator == (const OperationType& b);
+template <class T>
+constexpr T cross(const Vector<T>& a, const Vector<T>& b) // z of the 3D cross product.
+{
+    return a.x * b.y - a.y * b.x;
+}
 
+template <class T>
+constexpr Vector<T> perpendicular(const Vector<T>& v) // v turned a quarter.
+{
+    return Vector<T>(v.y, -v.x);
+}
 
-    template <typename OperationType>
-    bool operator != (const Vector<OperationType>& b);
-    template <typename OperationType>
-    bool operator != (const OperationType& b);
+template <class T>
+constexpr Vector<T> abs(const Vector<T>& v) // Component-wise.
+{
+    return Vector<T>(v.x < T(0) ? -v.x : v.x, v.y < T(0) ? -v.y : v.y);
+}
 
+template <class T>
+constexpr Vector<T> min(const Vector<T>& a, const Vector<T>& b) // Component-wise.
+{
+    return Vector<T>(b.x < a.x ? b.x : a.x, b.y < a.y ? b.y : a.y);
+}
 
-    template <typename OperationType>
-    void operator += (const Vector<OperationType>& b);
-    template <typename OperationType>
-    void operator += (const OperationType& b);
 
-    template <typename OperationType>
-    void operator -= (const Vector<OperationType>& b);
-    template <typename OperationType>
-    void operator -= (const OperationType& b);
+/*
+ * N vectors handled as one, stored as an array of x and an array of y.
+ *
+ * It has the operators of Vector, applied lane by lane. Every operator is a
+ * fixed-length loop over aligned arrays, which the compiler turns into SIMD
+ * instructions: four floats or ints fill an SSE register and eight fill an
+ * AVX register (with -mavx2 or a target attribute, see RotationKernel.cpp).
+ * A kernel written with packets therefore reads like the scalar code and
+ * runs like the intrinsic code.
+ *
+ * load and store move N consecutive points between a packet and the x and
+ * y arrays of a structure of arrays, such as the radii of a Border. The
+ * arrays themselves need not be aligned. Packets are aligned to the width
+ * of a lane array, so keep them on the stack rather than in containers.
+ */
+template <class T, std::size_t N>
+struct VectorPacket
+{
+    typedef T Scalar;
+    static const std::size_t SIZE = N;
+
+                                    VectorPacket();
+    explicit                        VectorPacket(const Vector<T>& v); // v in every lane.
+    static VectorPacket             load(const T* xs, const T* ys);
+    void                            store(T* xs, T* ys) const;
+
+    Vector<T>                       get(std::size_t lane) const;
+    void                            set(std::size_t lane, const Vector<T>& v);
+
+    VectorPacket&                   operator+=(const VectorPacket& b);
+    VectorPacket&                   operator-=(const VectorPacket& b);
+    VectorPacket&                   operator*=(const VectorPacket& b);
+    VectorPacket&                   operator/=(const VectorPacket& b);
+    VectorPacket&                   operator%=(const VectorPacket& b);
+    VectorPacket&                   operator+=(T b);
+    VectorPacket&                   operator-=(T b);
+    VectorPacket&                   operator*=(T b);
+    VectorPacket&                   operator/=(T b);
+    VectorPacket&                   operator%=(T b);
+
+    friend VectorPacket             operator-(const VectorPacket& a)                         { return VectorPacket() -= a; }
+    friend VectorPacket             operator+(const VectorPacket& a, const VectorPacket& b)  { return VectorPacket(a) += b; }
+    friend VectorPacket             operator-(const VectorPacket& a, const VectorPacket& b)  { return VectorPacket(a) -= b; }
+    friend VectorPacket             operator*(const VectorPacket& a, const VectorPacket& b)  { return VectorPacket(a) *= b; }
+    friend VectorPacket             operator/(const VectorPacket& a, const VectorPacket& b)  { return VectorPacket(a) /= b; }
+    friend VectorPacket             operator%(const VectorPacket& a, const VectorPacket& b)  { return VectorPacket(a) %= b; }
+    friend VectorPacket             operator+(const VectorPacket& a, T b)                    { return VectorPacket(a) += b; }
+    friend VectorPacket             operator-(const VectorPacket& a, T b)                    { return VectorPacket(a) -= b; }
+    friend VectorPacket             operator*(const VectorPacket& a, T b)                    { return VectorPacket(a) *= b; }
+    friend VectorPacket             operator/(const VectorPacket& a, T b)                    { return VectorPacket(a) /= b; }
+    friend VectorPacket             operator%(const VectorPacket& a, T b)                    { return VectorPacket(a) %= b; }
+    friend VectorPacket             operator*(T a, const VectorPacket& b)                    { return VectorPacket(b) *= a; }
+    friend bool                     operator==(const VectorPacket& a, const VectorPacket& b) { return a.isEqual(b); }
+    friend bool                     operator!=(const VectorPacket& a, const VectorPacket& b) { return !a.isEqual(b); }
+
+    bool                            isEqual(const VectorPacket& b) const; // In every lane.
+
+    alignas(sizeof(T) * N) T x[N];
+    alignas(sizeof(T) * N) T y[N];
+};
 
-    template <typename OperationType>
-    void operator *= (const Vector<OperationType>& b);
-    template <typename OperationType>
-    void operator *= (const OperationType& b);
+template <class T, std::size_t N>
+VectorPacket<T, N> perpendicular(const VectorPacket<T, N>& v)
+{
+    VectorPacket<T, N> turned;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        turned.x[i] = v.y[i];
+        turned.y[i] = -v.x[i];
+    }
+
+    return turned;
+}
 
-    template <typename OperationType>
-    void operator /= (const Vector<OperationType>& b);
-    template <typename OperationType>
-    void operator /= (const OperationType& b);
+typedef Vector<unsigned int>    Vectoru;
+typedef Vector<int>             Vectori;
+typedef Vector<float>           Vectorf;
+typedef Vector<char>            Vectorc;
 
-    template <typename OperationType>
-    void operator %= (const Vector<OperationType>& b);
-    template <typename OperationType>
-    void operator %= (const OperationType& b);
+typedef VectorPacket<float, 4>  Vector4f; // One SSE register per component.
+typedef VectorPacket<float, 8>  Vector8f; // One AVX register per component.
+typedef VectorPacket<int, 4>    Vector4i;
+typedef VectorPacket<int, 8>    Vector8i;
 
-    T x;
-    T y;
-};
 
 template <class T>
-Vector<T>::Vector()
+constexpr Vector<T>::Vector()
 : x(0)
 , y(0)
 {
-
 }
 
 template <class T>
-Vector<T>::Vector(T xParam, T yParam)
+constexpr Vector<T>::Vector(T xParam, T yParam)
 : x(xParam)
 , y(yParam)
 {
-
 }
 
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator + (const Vector<OperationType>& b)
+template <class T> template <class U>
+constexpr Vector<T>::Vector(const Vector<U>& other)
+: x(static_cast<T>(other.x))
+, y(static_cast<T>(other.y))
 {
-    return Vector<T>(x + b.x, y + b.y);
 }
 
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator + (const OperationType& b)
+template <class T>
+Vector<T>& Vector<T>::operator+=(const Vector& b)
 {
-    return Vector<T>(x + b, y + b);
+    x += b.x;
+    y += b.y;
+    return *this;
 }
 
-
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator - (const Vector<OperationType>& b)
+template <class T>
+Vector<T>& Vector<T>::operator-=(const Vector& b)
 {
-    return Vector<T>(x - b.x, y - b.y);
+    x -= b.x;
+    y -= b.y;
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator - (const OperationType& b)
+template <class T>
+Vector<T>& Vector<T>::operator*=(const Vector& b)
 {
-    return Vector<T>(x - b, y - b);
+    x *= b.x;
+    y *= b.y;
+    return *this;
 }
 
-
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator * (const Vector<OperationType>& b)
+template <class T>
+Vector<T>& Vector<T>::operator/=(const Vector& b)
 {
-    return Vector<T>(x * b.x, y * b.y);
+    x /= b.x;
+    y /= b.y;
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator * (const OperationType& b)
+template <class T>
+Vector<T>& Vector<T>::operator%=(const Vector& b)
 {
-    return Vector<T>(x * b, y * b);
+    x %= b.x;
+    y %= b.y;
+    return *this;
 }
 
-
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator / (const Vector<OperationType>& b)
+template <class T>
+Vector<T>& Vector<T>::operator+=(T b)
 {
-    return Vector<T>(x / b.x, y / b.y);
+    x += b;
+    y += b;
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator / (const OperationType& b)
+template <class T>
+Vector<T>& Vector<T>::operator-=(T b)
 {
-    return Vector<T>(x / b, y / b);
+    x -= b;
+    y -= b;
+    return *this;
 }
 
-
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator % (const Vector<OperationType>& b)
+template <class T>
+Vector<T>& Vector<T>::operator*=(T b)
 {
-    return Vector<T>(x % b.x, y % b.y);
+    x *= b;
+    y *= b;
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-Vector<T> Vector<T>::operator % (const OperationType& b)
+template <class T>
+Vector<T>& Vector<T>::operator/=(T b)
 {
-    return Vector<T>(x % b, y % b);
+    x /= b;
+    y /= b;
+    return *this;
 }
 
-
-template <class T> template <typename OperationType>
-void Vector<T>::operator = (const Vector<OperationType>& b)
+template <class T>
+Vector<T>& Vector<T>::operator%=(T b)
 {
-    x = b.x;
-    y = b.y;
+    x %= b;
+    y %= b;
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator = (const OperationType& b)
+
+template <class T, std::size_t N>
+VectorPacket<T, N>::VectorPacket()
 {
-    x = b;
-    y = b;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] = T(0);
+        y[i] = T(0);
+    }
 }
 
-
-template <class T> template <typename OperationType>
-bool Vector<T>::operator == (const Vector<OperationType>& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>::VectorPacket(const Vector<T>& v)
 {
-    return (x == b.x && y == b.y);
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] = v.x;
+        y[i] = v.y;
+    }
 }
 
-template <class T> template <typename OperationType>
-bool Vector<T>::operator == (const OperationType& b)
+template <class T, std::size_t N>
+VectorPacket<T, N> VectorPacket<T, N>::load(const T* xs, const T* ys)
 {
-    return (x == b && y == b);
+    VectorPacket packet;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        packet.x[i] = xs[i];
+        packet.y[i] = ys[i];
+    }
+
+    return packet;
 }
 
-
-template <class T> template <typename OperationType>
-bool Vector<T>::operator != (const Vector<OperationType>& b)
+template <class T, std::size_t N>
+void VectorPacket<T, N>::store(T* xs, T* ys) const
 {
-    return (x != b.x || y != b.y);
+    for(std::size_t i = 0; i < N; i++)
+    {
+        xs[i] = x[i];
+        ys[i] = y[i];
+    }
 }
 
-template <class T> template <typename OperationType>
-bool Vector<T>::operator != (const OperationType& b)
+template <class T, std::size_t N>
+Vector<T> VectorPacket<T, N>::get(std::size_t lane) const
 {
-    return (x != b || y != b);
+    assert(lane < N);
+    return Vector<T>(x[lane], y[lane]);
 }
 
-
-
-template <class T> template <typename OperationType>
-void Vector<T>::operator += (const Vector<OperationType>& b)
+template <class T, std::size_t N>
+void VectorPacket<T, N>::set(std::size_t lane, const Vector<T>& v)
 {
-    x += b.x;
-    y += b.y;
+    assert(lane < N);
+    x[lane] = v.x;
+    y[lane] = v.y;
 }
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator += (const OperationType& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator+=(const VectorPacket& b)
 {
-    x += b;
-    y += b;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] += b.x[i];
+        y[i] += b.y[i];
+    }
+
+    return *this;
 }
 
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator-=(const VectorPacket& b)
+{
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] -= b.x[i];
+        y[i] -= b.y[i];
+    }
 
+    return *this;
+}
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator -= (const Vector<OperationType>& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator*=(const VectorPacket& b)
 {
-    x -= b.x;
-    y -= b.y;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] *= b.x[i];
+        y[i] *= b.y[i];
+    }
+
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator -= (const OperationType& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator/=(const VectorPacket& b)
 {
-    x -= b;
-    y -= b;
-}
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] /= b.x[i];
+        y[i] /= b.y[i];
+    }
 
+    return *this;
+}
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator *= (const Vector<OperationType>& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator%=(const VectorPacket& b)
 {
-    x *= b.x;
-    y *= b.y;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] %= b.x[i];
+        y[i] %= b.y[i];
+    }
+
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator *= (const OperationType& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator+=(T b)
 {
-    x *= b;
-    y *= b;
-}
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] += b;
+        y[i] += b;
+    }
 
+    return *this;
+}
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator /= (const Vector<OperationType>& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator-=(T b)
 {
-    x /= b.x;
-    y /= b.y;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] -= b;
+        y[i] -= b;
+    }
+
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator /= (const OperationType& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator*=(T b)
 {
-    x /= b;
-    y /= b;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] *= b;
+        y[i] *= b;
+    }
+
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator %= (const Vector<OperationType>& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator/=(T b)
 {
-    x %= b.x;
-    y %= b.y;
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] /= b;
+        y[i] /= b;
+    }
+
+    return *this;
 }
 
-template <class T> template <typename OperationType>
-void Vector<T>::operator %= (const OperationType& b)
+template <class T, std::size_t N>
+VectorPacket<T, N>& VectorPacket<T, N>::operator%=(T b)
 {
-    x %= b;
-    y %= b;
-}
+    for(std::size_t i = 0; i < N; i++)
+    {
+        x[i] %= b;
+        y[i] %= b;
+    }
 
+    return *this;
+}
 
+template <class T, std::size_t N>
+bool VectorPacket<T, N>::isEqual(const VectorPacket& b) const
+{
+    bool equal = true;
+    for(std::size_t i = 0; i < N; i++)
+        equal &= x[i] == b.x[i] && y[i] == b.y[i];
 
-typedef Vector<unsigned int>    Vectoru;
-typedef Vector<int>             Vectori;
-typedef Vector<float>           Vectorf;
-typedef Vector<char>            Vectorc;
+    return equal;
+}
 
-#endif // VECTOR_H
+#endif // TECTO_VECTOR_HPP
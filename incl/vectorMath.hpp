@@ -20,13 +20,40 @@
 ****************************************************************
 ****************************************************************/
 
-#ifndef VECTORMATH_H
-#define VECTORMATH_H
+#ifndef TECTO_VECTORMATH_HPP
+#define TECTO_VECTORMATH_HPP
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Vector.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <limits>
+////////////////////////////////////////////////
 
 /*
-template <class VectorType>
-unsigned int distance(VectorType a, VectorType b);
-*/
+ * Distances between points on a world whose axes may wrap around.
+ *
+ * The distance along an axis that wraps is the shorter of the two ways
+ * around the world. period holds the world size of each axis, or infinity
+ * for an axis that does not wrap, so both kinds of axes go through the same
+ * branchless code. getPeriod makes it from a Topology. Both points must be
+ * inside the world.
+ */
+template <class Topology>
+Vectorf         getPeriod(const Topology& topology);
+
+float           getSquaredDistance(Vectorf a, Vectorf b, Vectorf period);
+
 
+template <class Topology>
+Vectorf getPeriod(const Topology& topology)
+{
+    const float unbounded = std::numeric_limits<float>::infinity();
+    return Vectorf(Topology::WRAPS_X ? float(topology.getSize().x) : unbounded,
+                   Topology::WRAPS_Y ? float(topology.getSize().y) : unbounded);
+}
 
-#endif // VECTORMATH_H
+#endif // TECTO_VECTORMATH_HPP
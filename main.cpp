@@ -29,6 +29,8 @@
 ////////////////////////////////////////////////
 // C++ Standard Library
 #include <utility>
+#include <ctime>
+#include <cstdlib>
 
 //////////////////////
 // DEBUG
@@ -43,10 +45,14 @@
 ////////////////////////////////////////////////
 
 
-int main()
+int main(int argc, char** argv)
 {
     unsigned int sizeX, sizeY;
+#ifdef TECTO_POWER_OF_TWO_WORLD
+    sizeX = sizeY = 512; // That topology only takes powers of two.
+#else
     sizeX = sizeY = 500;
+#endif // TECTO_POWER_OF_TWO_WORLD
 
     sf::RenderWindow window(sf::VideoMode(sizeX, sizeY), "VODKA", sf::Style::Default);
     const float YEARS_PER_TICK = 10.f;
@@ -56,7 +62,10 @@ int main()
     window.setKeyRepeatEnabled(false);
 
     //Lithosphere lithosphere(window.getSize().x, window.getSize().y);
-    Lithosphere lithosphere(sizeX, sizeY);
+    // A new world every run. Pass the printed seed as the first argument to see it again.
+    const uint64_t seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::time(nullptr);
+    std::cout << "Seed: " << seed << std::endl;
+    Lithosphere<StandardPayload> lithosphere(sizeX, sizeY, seed);
     sf::Clock clock;
     unsigned int ticks = 0;
     while(window.isOpen())
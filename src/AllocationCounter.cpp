@@ -0,0 +1,90 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+////////////////////////////////////////////////
+// Tecto library
+#include <AllocationCounter.hpp>
+////////////////////////////////////////////////
+
+#ifdef TECTO_COUNT_ALLOCATIONS
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <atomic>
+#include <cstdlib>
+#include <new>
+////////////////////////////////////////////////
+
+namespace
+{
+    std::atomic<std::size_t> allocationCount(0);
+}
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if(memory == nullptr)
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+std::size_t getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+#else
+
+std::size_t getAllocationCount()
+{
+    return 0;
+}
+
+#endif // TECTO_COUNT_ALLOCATIONS
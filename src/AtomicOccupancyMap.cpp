@@ -0,0 +1,62 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+////////////////////////////////////////////////
+// Tecto library
+#include <AtomicOccupancyMap.hpp>
+////////////////////////////////////////////////
+
+AtomicOccupancyMap::AtomicOccupancyMap(unsigned int sizeX, unsigned int sizeY, int count)
+: mSizeX(sizeX)
+, mSizeY(sizeY)
+, mCounts(new std::atomic<int8_t>[std::size_t(sizeX) * sizeY])
+{
+    for(unsigned int x = 0; x < sizeX; x++)
+        for(unsigned int y = 0; y < sizeY; y++)
+            setCount(x, y, count);
+}
+
+int AtomicOccupancyMap::increment(unsigned int x, unsigned int y)
+{
+    return mCounts[std::size_t(x) * mSizeY + y].fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+int AtomicOccupancyMap::decrement(unsigned int x, unsigned int y)
+{
+    return mCounts[std::size_t(x) * mSizeY + y].fetch_sub(1, std::memory_order_relaxed) - 1;
+}
+
+int AtomicOccupancyMap::getCount(unsigned int x, unsigned int y) const
+{
+    return mCounts[std::size_t(x) * mSizeY + y].load(std::memory_order_relaxed);
+}
+
+void AtomicOccupancyMap::setCount(unsigned int x, unsigned int y, int count)
+{
+    mCounts[std::size_t(x) * mSizeY + y].store(int8_t(count), std::memory_order_relaxed);
+}
+
+std::size_t AtomicOccupancyMap::getMemoryUsage() const
+{
+    return std::size_t(mSizeX) * mSizeY * sizeof(std::atomic<int8_t>);
+}
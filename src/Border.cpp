@@ -0,0 +1,344 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Border.hpp>
+#include <Vector.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cassert>
+#include <algorithm>
+////////////////////////////////////////////////
+
+Border::Border(const std::vector<BorderCrust>& crusts, sf::Vector2i worldSize)
+: mWorldSize(worldSize)
+, mPlate(crusts.empty() ? 0 : crusts.front().getSourceHandle().mPlate)
+, mOriginalIndices(worldSize)
+, mArea(0.0)
+, mOrientation(1)
+{
+    for(std::vector<Coordinate>* v : {&mRadiiX, &mRadiiY, &mOffsetsX, &mOffsetsY})
+        v->reserve(crusts.size());
+
+    mIndices.reserve(crusts.size());
+    mOriginalIndices.reserve(crusts.size());
+    mSourceHandles.reserve(crusts.size());
+
+    for(const BorderCrust& crust : crusts)
+    {
+        mIndices.push_back(crust.getIndex());
+        mOriginalIndices.pushBack(crust.getOriginalIndex());
+        mSourceHandles.push_back(crust.getSourceHandle());
+        mRadiiX.push_back(Coordinate(crust.getRadiusVector().x));
+        mRadiiY.push_back(Coordinate(crust.getRadiusVector().y));
+        mOffsetsX.push_back(0);
+        mOffsetsY.push_back(0);
+
+        assert(crust.getSourceHandle().mPlate == mPlate);
+    }
+
+    mNormalsX.resize(crusts.size());
+    mNormalsY.resize(crusts.size());
+    updateNormals();
+}
+
+void Border::splice(const bool* erase, const Insertion* insertions, std::size_t insertionCount, ScratchArena& arena)
+{
+    // Every stretch of erased crusts, together with the crusts inserted
+    // around it, becomes one run.
+    std::size_t size = getSize();
+    SpliceRun* runs = arena.allocate<SpliceRun>(std::count(erase, erase + size, true) + insertionCount);
+    std::size_t runCount = 0;
+    const Insertion* insertion = insertions;
+    const Insertion* insertionsEnd = insertions + insertionCount;
+    for(std::size_t i = 0; i <= size; i++)
+    {
+        std::size_t insertCount = 0;
+        for(; insertion != insertionsEnd && insertion->mPosition == i; insertion++)
+            insertCount++;
+
+        bool isErased = i < size && erase[i];
+        if(insertCount == 0 && !isErased)
+            continue;
+
+        if(runCount == 0 || runs[runCount - 1].mPosition + runs[runCount - 1].mEraseCount != i)
+            runs[runCount++] = SpliceRun{i, 0, 0};
+
+        runs[runCount - 1].mEraseCount += isErased;
+        runs[runCount - 1].mInsertCount += insertCount;
+    }
+
+    assert(insertion == insertionsEnd);
+
+    // The edges from the crust before each run to the crust after it are the
+    // only ones that change. If the first and last runs meet around the end
+    // of the loop, they share the edge from the last crust to the first.
+    bool isWrapped = runCount > 1 && runs[0].mPosition == 0 && runs[runCount - 1].mPosition + runs[runCount - 1].mEraseCount == size;
+    double area = mArea + (isWrapped ? getCross(size - 1, 0) : 0.0);
+    for(std::size_t iRun = 0; iRun < runCount; iRun++)
+        area -= getRunCross(runs[iRun].mPosition, runs[iRun].mEraseCount);
+
+    std::size_t newSize = getSplicedSize(size, runs, runCount);
+    resize(std::max(size, newSize));
+
+    shiftKeptBlocks(size, runs, runCount, [this](std::size_t begin, std::size_t end, std::ptrdiff_t shift)
+    {
+        shiftBlock(mIndices.data(), begin, end, shift);
+        shiftBlock(mSourceHandles.data(), begin, end, shift);
+        shiftBlock(mRadiiX.data(), begin, end, shift);
+        shiftBlock(mRadiiY.data(), begin, end, shift);
+        shiftBlock(mOffsetsX.data(), begin, end, shift);
+        shiftBlock(mOffsetsY.data(), begin, end, shift);
+        shiftBlock(mNormalsX.data(), begin, end, shift);
+        shiftBlock(mNormalsY.data(), begin, end, shift);
+    });
+
+    // Write the inserted crusts where their runs have moved to.
+    sf::Vector2i* originalIndices = arena.allocate<sf::Vector2i>(insertionCount);
+    insertion = insertions;
+    std::ptrdiff_t shift = 0;
+    for(std::size_t iRun = 0; iRun < runCount; iRun++)
+    {
+        std::size_t position = runs[iRun].mPosition + shift;
+        for(std::size_t i = 0; i < runs[iRun].mInsertCount; i++, insertion++)
+        {
+            mIndices[position + i] = insertion->mIndex;
+            mSourceHandles[position + i] = createSourceHandle(insertion->mOriginalIndex);
+            mRadiiX[position + i] = insertion->mRadiusVector.x;
+            mRadiiY[position + i] = insertion->mRadiusVector.y;
+            mOffsetsX[position + i] = insertion->mOriginalOffset.x;
+            mOffsetsY[position + i] = insertion->mOriginalOffset.y;
+            originalIndices[insertion - insertions] = insertion->mOriginalIndex;
+        }
+
+        shift += std::ptrdiff_t(runs[iRun].mInsertCount) - std::ptrdiff_t(runs[iRun].mEraseCount);
+    }
+
+    resize(newSize);
+    mOriginalIndices.splice(runs, runCount, originalIndices, arena);
+
+    // Now the runs are their inserted crusts.
+    shift = 0;
+    for(std::size_t iRun = 0; iRun < runCount; iRun++)
+    {
+        area += getRunCross(runs[iRun].mPosition + shift, runs[iRun].mInsertCount);
+        shift += std::ptrdiff_t(runs[iRun].mInsertCount) - std::ptrdiff_t(runs[iRun].mEraseCount);
+    }
+
+    mArea = area - (isWrapped ? getCross(newSize - 1, 0) : 0.0);
+
+    // A loop that has turned inside out needs every normal flipped.
+    if((mArea >= 0.0 ? 1 : -1) != mOrientation)
+    {
+        updateNormals();
+        return;
+    }
+
+    // Only the inserted crusts and the crusts on either side of them have new neighbours.
+    shift = 0;
+    for(std::size_t iRun = 0; iRun < runCount; iRun++)
+    {
+        std::size_t position = getPrevious(runs[iRun].mPosition + shift);
+        for(std::size_t i = 0; i < runs[iRun].mInsertCount + 2; i++, position = getNext(position))
+            updateNormal(position);
+
+        shift += std::ptrdiff_t(runs[iRun].mInsertCount) - std::ptrdiff_t(runs[iRun].mEraseCount);
+    }
+}
+
+std::size_t Border::getSize() const
+{
+    return mIndices.size();
+}
+
+std::size_t Border::getCapacity() const
+{
+    return mIndices.capacity();
+}
+
+std::size_t Border::getNext(std::size_t position) const
+{
+    position++;
+    return position == getSize() ? 0 : position;
+}
+
+std::size_t Border::getPrevious(std::size_t position) const
+{
+    return position == 0 ? getSize() - 1 : position - 1;
+}
+
+const sf::Vector2i& Border::getIndex(std::size_t position) const
+{
+    return mIndices[position];
+}
+
+void Border::setIndex(std::size_t position, sf::Vector2i index)
+{
+    mIndices[position] = index;
+}
+
+sf::Vector2i Border::getOriginalIndex(std::size_t position) const
+{
+    return mOriginalIndices.get(position);
+}
+
+ChainCode::Decoder Border::getOriginalIndices(std::size_t position) const
+{
+    return mOriginalIndices.getDecoder(position);
+}
+
+sf::Vector2<Coordinate> Border::getRadiusVector(std::size_t position) const
+{
+    return sf::Vector2<Coordinate>(mRadiiX[position], mRadiiY[position]);
+}
+
+const CrustHandle& Border::getSourceHandle(std::size_t position) const
+{
+    return mSourceHandles[position];
+}
+
+Coordinate* Border::getRadiiX()
+{
+    return mRadiiX.data();
+}
+
+Coordinate* Border::getRadiiY()
+{
+    return mRadiiY.data();
+}
+
+const Coordinate* Border::getOriginalOffsetsX() const
+{
+    return mOffsetsX.data();
+}
+
+const Coordinate* Border::getOriginalOffsetsY() const
+{
+    return mOffsetsY.data();
+}
+
+void Border::updateNormals()
+{
+    std::size_t size = getSize();
+    if(size < 3)
+        return;
+
+    // The sign of the area tells which side of the loop is outside. Rotation
+    // does not change it, but inserting and erasing crusts might.
+    mArea = 0.0;
+    for(std::size_t i = 0, j = size - 1; i < size; j = i++)
+        mArea += getCross(j, i);
+
+    mOrientation = mArea >= 0.0 ? 1 : -1;
+
+    // Packets cover the middle crusts, whose neighbours are next to them in
+    // memory.
+    typedef VectorPacket<Coordinate, 8> Packet;
+    const Coordinate orientation(mOrientation);
+
+    updateNormal(0);
+    std::size_t i = 1;
+    for(; i + Packet::SIZE < size; i += Packet::SIZE)
+    {
+        Packet previous = Packet::load(&mRadiiX[i - 1], &mRadiiY[i - 1]);
+        Packet next = Packet::load(&mRadiiX[i + 1], &mRadiiY[i + 1]);
+        (perpendicular(next - previous) * orientation).store(&mNormalsX[i], &mNormalsY[i]);
+    }
+
+    for(; i + 1 < size; i++)
+    {
+        mNormalsX[i] = (mRadiiY[i + 1] - mRadiiY[i - 1]) * orientation;
+        mNormalsY[i] = (mRadiiX[i - 1] - mRadiiX[i + 1]) * orientation;
+    }
+    updateNormal(size - 1);
+}
+
+sf::Vector2<Coordinate> Border::getNormal(std::size_t position) const
+{
+    return sf::Vector2<Coordinate>(mNormalsX[position], mNormalsY[position]);
+}
+
+// The normal is the line from the previous to the next crust turned a
+// quarter outwards.
+void Border::updateNormal(std::size_t position)
+{
+    std::size_t next = getNext(position);
+    std::size_t previous = getPrevious(position);
+    mNormalsX[position] = (mRadiiY[next] - mRadiiY[previous]) * Coordinate(mOrientation);
+    mNormalsY[position] = (mRadiiX[previous] - mRadiiX[next]) * Coordinate(mOrientation);
+}
+
+// Twice the signed area of the triangle between the rotational center and
+// the edge from one crust to another.
+double Border::getCross(std::size_t from, std::size_t to) const
+{
+    return double(mRadiiX[from]) * double(mRadiiY[to]) - double(mRadiiX[to]) * double(mRadiiY[from]);
+}
+
+// getCross() summed over the edges from the crust before position, through
+// the count crusts from position on, to the crust after them. position may
+// be getSize() for crusts at the end.
+double Border::getRunCross(std::size_t position, std::size_t count) const
+{
+    std::size_t size = getSize();
+    std::size_t from = getPrevious(position == size ? 0 : position);
+    double cross = 0.0;
+    for(std::size_t i = position; i <= position + count; i++)
+    {
+        std::size_t to = i < size ? i : i - size;
+        cross += getCross(from, to);
+        from = to;
+    }
+
+    return cross;
+}
+
+// Resize every array but the original indices, which splice() resizes itself.
+void Border::resize(std::size_t size)
+{
+    mIndices.resize(size);
+    mSourceHandles.resize(size);
+    for(std::vector<Coordinate>* v : {&mRadiiX, &mRadiiY, &mOffsetsX, &mOffsetsY, &mNormalsX, &mNormalsY})
+        v->resize(size);
+}
+
+// A crust added to the border comes from the crust at its original index.
+CrustHandle Border::createSourceHandle(sf::Vector2i originalIndex) const
+{
+    return CrustHandle(originalIndex.x * mWorldSize.y + originalIndex.y, mPlate);
+}
+
+std::size_t Border::getMemoryUsage() const
+{
+    return  mIndices.capacity() * sizeof(sf::Vector2i)
+            + mOriginalIndices.getMemoryUsage()
+            + mSourceHandles.capacity() * sizeof(CrustHandle)
+            + mRadiiX.capacity() * sizeof(Coordinate)
+            + mRadiiY.capacity() * sizeof(Coordinate)
+            + mOffsetsX.capacity() * sizeof(Coordinate)
+            + mOffsetsY.capacity() * sizeof(Coordinate)
+            + mNormalsX.capacity() * sizeof(Coordinate)
+            + mNormalsY.capacity() * sizeof(Coordinate);
+}
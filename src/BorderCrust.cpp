@@ -26,11 +26,11 @@
 ////////////////////////////////////////////////
 
 
-BorderCrust::BorderCrust(sf::Vector2i index, Crust& sourceCrust)
-: mOriginalIndex(index)
+BorderCrust::BorderCrust(sf::Vector2i index, CrustHandle sourceCrust)
+: mSourceCrust(sourceCrust)
+, mOriginalIndex(index)
 , mIndex(mOriginalIndex)
 , mRadiusVector(0, 0)
-, mSourceCrust(sourceCrust)
 {
 }
 
@@ -59,7 +59,7 @@ const sf::Vector2f& BorderCrust::getRadiusVector() const
     return mRadiusVector;
 }
 
-Crust& BorderCrust::getSourceCrust()
+const CrustHandle& BorderCrust::getSourceHandle() const
 {
     return mSourceCrust;
 }
@@ -0,0 +1,624 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+////////////////////////////////////////////////
+// Tecto library
+#include <CellSet.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <algorithm>
+#include <iterator>
+////////////////////////////////////////////////
+
+namespace
+{
+    // The bits of bitmap word that lie in the cells [first, last).
+    uint64_t getMask(uint32_t first, uint32_t last, std::size_t word)
+    {
+        uint32_t begin = std::max<uint32_t>(first, word * 64);
+        uint32_t end = std::min<uint32_t>(last, word * 64 + 64);
+        if(begin >= end)
+            return 0;
+
+        unsigned int bits = end - begin;
+        uint64_t ones = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        return ones << (begin - word * 64);
+    }
+
+    // Set whole words where possible.
+    void setBits(uint64_t* bitmap, uint32_t first, uint32_t last)
+    {
+        for(std::size_t i = first / 64; i * 64 < last; i++)
+            bitmap[i] |= getMask(first, last, i);
+    }
+}
+
+CellSet::Chunk::Chunk(uint16_t key)
+: mKey(key)
+, mCount(0)
+{
+}
+
+bool CellSet::Chunk::isBitmap() const
+{
+    return !mBitmap.empty();
+}
+
+bool CellSet::Chunk::isRuns() const
+{
+    return !mRuns.empty();
+}
+
+bool CellSet::Chunk::contains(uint16_t low) const
+{
+    if(isBitmap())
+        return (mBitmap[low / 64] >> (low % 64)) & 1;
+
+    if(isRuns())
+    {
+        auto it = std::upper_bound(mRuns.begin(), mRuns.end(), low, [](uint16_t l, const Run& run) { return l < run.mStart; });
+        return it != mRuns.begin() && std::prev(it)->mLast >= low;
+    }
+
+    return std::binary_search(mArray.begin(), mArray.end(), low);
+}
+
+void CellSet::Chunk::insert(uint16_t low)
+{
+    if(isBitmap())
+    {
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if(!(mBitmap[low / 64] & bit))
+        {
+            mBitmap[low / 64] |= bit;
+            mCount++;
+        }
+        return;
+    }
+
+    if(isRuns())
+    {
+        std::size_t runCount = mRuns.size();
+        insertRange(low, low + 1);
+        if(mRuns.size() > runCount)
+            fit();
+        return;
+    }
+
+    auto it = std::lower_bound(mArray.begin(), mArray.end(), low);
+    if(it != mArray.end() && *it == low)
+        return;
+
+    mArray.insert(it, low);
+    mCount++;
+
+    if(mCount > MAX_ARRAY_SIZE)
+        toBitmap();
+}
+
+void CellSet::Chunk::insertRange(uint32_t first, uint32_t last)
+{
+    if(isRuns())
+    {
+        // Merge every run that overlaps or touches the range into one.
+        auto begin = std::lower_bound(mRuns.begin(), mRuns.end(), first, [](const Run& run, uint32_t f) { return uint32_t(run.mLast) + 1 < f; });
+        auto end = begin;
+        uint32_t start = first;
+        uint32_t lastCell = last - 1;
+        for(; end != mRuns.end() && end->mStart <= last; end++)
+        {
+            start = std::min<uint32_t>(start, end->mStart);
+            lastCell = std::max<uint32_t>(lastCell, end->mLast);
+            mCount -= end->mLast - end->mStart + 1;
+        }
+
+        mCount += lastCell - start + 1;
+        begin = mRuns.erase(begin, end);
+        mRuns.insert(begin, Run{uint16_t(start), uint16_t(lastCell)});
+    }
+    else if(!isBitmap() && mCount + (last - first) <= MAX_ARRAY_SIZE)
+    {
+        for(uint32_t low = first; low < last; low++)
+            insert(low);
+    }
+    else
+    {
+        toBitmap();
+        setBits(mBitmap.data(), first, last);
+
+        mCount = 0;
+        for(uint64_t word : mBitmap)
+            mCount += __builtin_popcountll(word);
+    }
+}
+
+void CellSet::Chunk::erase(uint16_t low)
+{
+    if(isBitmap())
+    {
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if(mBitmap[low / 64] & bit)
+        {
+            mBitmap[low / 64] &= ~bit;
+            mCount--;
+        }
+
+        // Leave some room so that a chunk on the edge does not flip back and forth.
+        if(mCount <= MAX_ARRAY_SIZE / 2)
+            toArray();
+        return;
+    }
+
+    if(isRuns())
+    {
+        auto it = std::upper_bound(mRuns.begin(), mRuns.end(), low, [](uint16_t l, const Run& run) { return l < run.mStart; });
+        if(it == mRuns.begin() || std::prev(it)->mLast < low)
+            return;
+
+        Run& run = *--it;
+        mCount--;
+        if(run.mStart == run.mLast)
+            mRuns.erase(it);
+        else if(low == run.mStart)
+            run.mStart++;
+        else if(low == run.mLast)
+            run.mLast--;
+        else
+        {
+            // Split the run in two.
+            Run tail{uint16_t(low + 1), run.mLast};
+            run.mLast = low - 1;
+            mRuns.insert(it + 1, tail);
+            fit();
+        }
+        return;
+    }
+
+    auto it = std::lower_bound(mArray.begin(), mArray.end(), low);
+    if(it != mArray.end() && *it == low)
+    {
+        mArray.erase(it);
+        mCount--;
+    }
+}
+
+void CellSet::Chunk::toBitmap()
+{
+    if(isBitmap())
+        return;
+
+    std::vector<uint64_t> bitmap(BITMAP_WORDS, 0);
+    for(const Run& run : mRuns)
+        setBits(bitmap.data(), run.mStart, uint32_t(run.mLast) + 1);
+
+    for(uint16_t low : mArray)
+        bitmap[low / 64] |= uint64_t(1) << (low % 64);
+
+    std::vector<uint16_t>().swap(mArray);
+    std::vector<Run>().swap(mRuns);
+    mBitmap.swap(bitmap);
+}
+
+void CellSet::Chunk::toArray()
+{
+    if(!isBitmap() && !isRuns())
+        return;
+
+    std::vector<uint16_t> array;
+    array.reserve(mCount);
+    forEachLow([&array](uint32_t low)
+    {
+        array.push_back(low);
+    });
+
+    std::vector<uint64_t>().swap(mBitmap);
+    std::vector<Run>().swap(mRuns);
+    mArray.swap(array);
+}
+
+void CellSet::Chunk::toRuns()
+{
+    if(isRuns() || mCount == 0)
+        return;
+
+    std::vector<Run> runs;
+    runs.reserve(getRunCount());
+    forEachLow([&runs](uint32_t low)
+    {
+        if(!runs.empty() && uint32_t(runs.back().mLast) + 1 == low)
+            runs.back().mLast = low;
+        else
+            runs.push_back(Run{uint16_t(low), uint16_t(low)});
+    });
+
+    std::vector<uint64_t>().swap(mBitmap);
+    std::vector<uint16_t>().swap(mArray);
+    mRuns.swap(runs);
+}
+
+void CellSet::Chunk::fit()
+{
+    std::size_t runBytes = getRunCount() * sizeof(Run);
+    std::size_t otherBytes = mCount <= MAX_ARRAY_SIZE ? mCount * sizeof(uint16_t) : BITMAP_WORDS * sizeof(uint64_t);
+    if(runBytes < otherBytes)
+        toRuns();
+    else if(mCount <= MAX_ARRAY_SIZE)
+        toArray();
+    else
+        toBitmap();
+}
+
+std::size_t CellSet::Chunk::getRunCount() const
+{
+    if(isRuns())
+        return mRuns.size();
+
+    // A run starts at every cell whose cell before is not in the chunk.
+    std::size_t count = 0;
+    if(isBitmap())
+    {
+        uint64_t previous = 0;
+        for(uint64_t word : mBitmap)
+        {
+            count += __builtin_popcountll(word & ~(word << 1 | previous >> 63));
+            previous = word;
+        }
+    }
+    else
+    {
+        for(std::size_t i = 0; i < mArray.size(); i++)
+            count += i == 0 || mArray[i] != mArray[i - 1] + 1;
+    }
+
+    return count;
+}
+
+CellSet::CellSet()
+{
+}
+
+void CellSet::insert(uint32_t cell)
+{
+    getChunk(cell >> 16).insert(cell & 0xFFFF);
+}
+
+void CellSet::insertRange(uint32_t first, uint32_t last)
+{
+    while(first < last)
+    {
+        uint16_t key = first >> 16;
+        uint32_t chunkEnd = (uint32_t(key) + 1) << 16;
+        uint32_t end = last < chunkEnd ? last : chunkEnd;
+        Chunk& chunk = getChunk(key);
+        chunk.insertRange(first & 0xFFFF, end - (uint32_t(key) << 16));
+        chunk.fit();
+
+        first = end;
+    }
+}
+
+void CellSet::erase(uint32_t cell)
+{
+    Chunk* chunk = findChunk(cell >> 16);
+    if(chunk == nullptr)
+        return;
+
+    chunk->erase(cell & 0xFFFF);
+    if(chunk->mCount == 0)
+        mChunks.erase(mChunks.begin() + (chunk - mChunks.data()));
+}
+
+void CellSet::clear()
+{
+    mChunks.clear();
+}
+
+bool CellSet::contains(uint32_t cell) const
+{
+    const Chunk* chunk = findChunk(cell >> 16);
+    return chunk != nullptr && chunk->contains(cell & 0xFFFF);
+}
+
+bool CellSet::isEmpty() const
+{
+    return mChunks.empty();
+}
+
+std::size_t CellSet::getCount() const
+{
+    std::size_t count = 0;
+    for(const Chunk& chunk : mChunks)
+        count += chunk.mCount;
+
+    return count;
+}
+
+CellSet CellSet::getUnion(const CellSet& other) const
+{
+    CellSet result;
+    auto a = mChunks.begin();
+    auto b = other.mChunks.begin();
+    while(a != mChunks.end() || b != other.mChunks.end())
+    {
+        if(b == other.mChunks.end() || (a != mChunks.end() && a->mKey < b->mKey))
+            result.mChunks.push_back(*a++);
+        else if(a == mChunks.end() || b->mKey < a->mKey)
+            result.mChunks.push_back(*b++);
+        else
+            result.mChunks.push_back(unite(*a++, *b++));
+    }
+
+    return result;
+}
+
+CellSet CellSet::getIntersection(const CellSet& other) const
+{
+    CellSet result;
+    auto a = mChunks.begin();
+    auto b = other.mChunks.begin();
+    while(a != mChunks.end() && b != other.mChunks.end())
+    {
+        if(a->mKey < b->mKey)
+            a++;
+        else if(b->mKey < a->mKey)
+            b++;
+        else
+        {
+            Chunk chunk = intersect(*a++, *b++);
+            if(chunk.mCount > 0)
+                result.mChunks.push_back(std::move(chunk));
+        }
+    }
+
+    return result;
+}
+
+std::size_t CellSet::getIntersectionCount(const CellSet& other) const
+{
+    std::size_t count = 0;
+    auto a = mChunks.begin();
+    auto b = other.mChunks.begin();
+    while(a != mChunks.end() && b != other.mChunks.end())
+    {
+        if(a->mKey < b->mKey)
+            a++;
+        else if(b->mKey < a->mKey)
+            b++;
+        else
+            count += getIntersectionCount(*a++, *b++);
+    }
+
+    return count;
+}
+
+std::size_t CellSet::getMemoryUsage() const
+{
+    std::size_t bytes = mChunks.capacity() * sizeof(Chunk);
+    for(const Chunk& chunk : mChunks)
+        bytes += chunk.mArray.capacity() * sizeof(uint16_t) + chunk.mBitmap.capacity() * sizeof(uint64_t) + chunk.mRuns.capacity() * sizeof(Run);
+
+    return bytes;
+}
+
+CellSet::Chunk CellSet::unite(const Chunk& a, const Chunk& b)
+{
+    Chunk result(a.mKey);
+    if(!a.isBitmap() && !a.isRuns() && !b.isBitmap() && !b.isRuns())
+    {
+        std::set_union(a.mArray.begin(), a.mArray.end(), b.mArray.begin(), b.mArray.end(), std::back_inserter(result.mArray));
+        result.mCount = result.mArray.size();
+    }
+    else if(a.isRuns() && b.isRuns())
+    {
+        // Take the runs in order of their start, merging each into the last
+        // one taken if they overlap or touch.
+        auto iA = a.mRuns.begin();
+        auto iB = b.mRuns.begin();
+        while(iA != a.mRuns.end() || iB != b.mRuns.end())
+        {
+            const Run& run = (iB == b.mRuns.end() || (iA != a.mRuns.end() && iA->mStart < iB->mStart)) ? *iA++ : *iB++;
+            if(!result.mRuns.empty() && uint32_t(result.mRuns.back().mLast) + 1 >= run.mStart)
+                result.mRuns.back().mLast = std::max(result.mRuns.back().mLast, run.mLast);
+            else
+                result.mRuns.push_back(run);
+        }
+
+        for(const Run& run : result.mRuns)
+            result.mCount += run.mLast - run.mStart + 1;
+    }
+    else
+    {
+        result.mBitmap.assign(BITMAP_WORDS, 0);
+        for(const Chunk* chunk : {&a, &b})
+        {
+            if(chunk->isBitmap())
+                for(std::size_t i = 0; i < BITMAP_WORDS; i++)
+                    result.mBitmap[i] |= chunk->mBitmap[i];
+            else if(chunk->isRuns())
+                for(const Run& run : chunk->mRuns)
+                    setBits(result.mBitmap.data(), run.mStart, uint32_t(run.mLast) + 1);
+            else
+                for(uint16_t low : chunk->mArray)
+                    result.mBitmap[low / 64] |= uint64_t(1) << (low % 64);
+        }
+
+        for(uint64_t word : result.mBitmap)
+            result.mCount += __builtin_popcountll(word);
+    }
+
+    result.fit();
+    return result;
+}
+
+CellSet::Chunk CellSet::intersect(const Chunk& a, const Chunk& b)
+{
+    Chunk result(a.mKey);
+    if(a.isBitmap() && b.isBitmap())
+    {
+        result.mBitmap.resize(BITMAP_WORDS);
+        for(std::size_t i = 0; i < BITMAP_WORDS; i++)
+        {
+            result.mBitmap[i] = a.mBitmap[i] & b.mBitmap[i];
+            result.mCount += __builtin_popcountll(result.mBitmap[i]);
+        }
+    }
+    else if(!a.isBitmap() && !a.isRuns() && !b.isBitmap() && !b.isRuns())
+    {
+        std::set_intersection(a.mArray.begin(), a.mArray.end(), b.mArray.begin(), b.mArray.end(), std::back_inserter(result.mArray));
+        result.mCount = result.mArray.size();
+    }
+    else if(!a.isBitmap() && !a.isRuns())
+    {
+        for(uint16_t low : a.mArray)
+            if(b.contains(low))
+                result.mArray.push_back(low);
+
+        result.mCount = result.mArray.size();
+    }
+    else if(!b.isBitmap() && !b.isRuns())
+    {
+        return intersect(b, a);
+    }
+    else if(a.isRuns() && b.isRuns())
+    {
+        auto iA = a.mRuns.begin();
+        auto iB = b.mRuns.begin();
+        while(iA != a.mRuns.end() && iB != b.mRuns.end())
+        {
+            uint16_t start = std::max(iA->mStart, iB->mStart);
+            uint16_t last = std::min(iA->mLast, iB->mLast);
+            if(start <= last)
+            {
+                result.mRuns.push_back(Run{start, last});
+                result.mCount += last - start + 1;
+            }
+
+            if(iA->mLast < iB->mLast)
+                iA++;
+            else
+                iB++;
+        }
+    }
+    else
+    {
+        // Runs and a bitmap: keep the bits of the bitmap under the runs.
+        const Chunk& runs = a.isRuns() ? a : b;
+        const Chunk& bitmap = a.isRuns() ? b : a;
+        result.mBitmap.assign(BITMAP_WORDS, 0);
+        for(const Run& run : runs.mRuns)
+            for(std::size_t i = run.mStart / 64; i <= run.mLast / 64u; i++)
+                result.mBitmap[i] |= bitmap.mBitmap[i] & getMask(run.mStart, uint32_t(run.mLast) + 1, i);
+
+        for(uint64_t word : result.mBitmap)
+            result.mCount += __builtin_popcountll(word);
+    }
+
+    result.fit();
+    return result;
+}
+
+std::size_t CellSet::getIntersectionCount(const Chunk& a, const Chunk& b)
+{
+    std::size_t count = 0;
+    if(a.isBitmap() && b.isBitmap())
+    {
+        for(std::size_t i = 0; i < BITMAP_WORDS; i++)
+            count += __builtin_popcountll(a.mBitmap[i] & b.mBitmap[i]);
+    }
+    else if(!a.isBitmap() && !a.isRuns() && !b.isBitmap() && !b.isRuns())
+    {
+        auto iA = a.mArray.begin();
+        auto iB = b.mArray.begin();
+        while(iA != a.mArray.end() && iB != b.mArray.end())
+        {
+            if(*iA < *iB)
+                iA++;
+            else if(*iB < *iA)
+                iB++;
+            else
+            {
+                count++;
+                iA++;
+                iB++;
+            }
+        }
+    }
+    else if(!a.isBitmap() && !a.isRuns())
+    {
+        for(uint16_t low : a.mArray)
+            count += b.contains(low);
+    }
+    else if(!b.isBitmap() && !b.isRuns())
+    {
+        return getIntersectionCount(b, a);
+    }
+    else if(a.isRuns() && b.isRuns())
+    {
+        auto iA = a.mRuns.begin();
+        auto iB = b.mRuns.begin();
+        while(iA != a.mRuns.end() && iB != b.mRuns.end())
+        {
+            uint16_t start = std::max(iA->mStart, iB->mStart);
+            uint16_t last = std::min(iA->mLast, iB->mLast);
+            if(start <= last)
+                count += last - start + 1;
+
+            if(iA->mLast < iB->mLast)
+                iA++;
+            else
+                iB++;
+        }
+    }
+    else
+    {
+        const Chunk& runs = a.isRuns() ? a : b;
+        const Chunk& bitmap = a.isRuns() ? b : a;
+        for(const Run& run : runs.mRuns)
+            for(std::size_t i = run.mStart / 64; i <= run.mLast / 64u; i++)
+                count += __builtin_popcountll(bitmap.mBitmap[i] & getMask(run.mStart, uint32_t(run.mLast) + 1, i));
+    }
+
+    return count;
+}
+
+CellSet::Chunk* CellSet::findChunk(uint16_t key)
+{
+    auto it = std::lower_bound(mChunks.begin(), mChunks.end(), key, [](const Chunk& chunk, uint16_t k) { return chunk.mKey < k; });
+    return (it != mChunks.end() && it->mKey == key) ? &(*it) : nullptr;
+}
+
+const CellSet::Chunk* CellSet::findChunk(uint16_t key) const
+{
+    auto it = std::lower_bound(mChunks.begin(), mChunks.end(), key, [](const Chunk& chunk, uint16_t k) { return chunk.mKey < k; });
+    return (it != mChunks.end() && it->mKey == key) ? &(*it) : nullptr;
+}
+
+CellSet::Chunk& CellSet::getChunk(uint16_t key)
+{
+    auto it = std::lower_bound(mChunks.begin(), mChunks.end(), key, [](const Chunk& chunk, uint16_t k) { return chunk.mKey < k; });
+    if(it == mChunks.end() || it->mKey != key)
+        it = mChunks.insert(it, Chunk(key));
+
+    return *it;
+}
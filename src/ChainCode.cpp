@@ -0,0 +1,347 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+////////////////////////////////////////////////
+// Tecto library
+#include <ChainCode.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <algorithm>
+#include <cassert>
+////////////////////////////////////////////////
+
+// Freeman directions, counter-clockwise from east. Y grows downwards.
+const int ChainCode::DIRECTIONS[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+
+namespace
+{
+    // Direction code of each (dx + 1) + (dy + 1) * 3, or -1 if there is none.
+    const int DIRECTION_CODES[9] = {5, 6, 7, 4, -1, 0, 3, 2, 1};
+    const unsigned int JUMP_CODE = 0; // Placeholder code of a jump. The jump table decides.
+}
+
+ChainCode::Decoder::Decoder(const ChainCode& chain, std::size_t position)
+: mChain(&chain)
+, mPosition(0)
+, mNextJump(0)
+, mCell()
+{
+    if(chain.mCheckpoints.empty())
+        return;
+
+    const Checkpoint& checkpoint = chain.findCheckpoint(position);
+    mPosition = checkpoint.first;
+    mCell = checkpoint.second;
+    mNextJump = chain.findJump(mPosition + 1);
+    while(mPosition < position)
+        ++(*this);
+}
+
+const sf::Vector2i& ChainCode::Decoder::operator*() const
+{
+    return mCell;
+}
+
+ChainCode::Decoder& ChainCode::Decoder::operator++()
+{
+    mPosition++;
+    if(mPosition >= mChain->mSize)
+        return *this;
+
+    if(mNextJump < mChain->mJumps.size() && mChain->mJumps[mNextJump].first == mPosition)
+    {
+        mCell = mChain->mJumps[mNextJump].second;
+        mNextJump++;
+    }
+    else
+        mCell = mChain->step(mCell, mChain->getCode(mPosition));
+
+    return *this;
+}
+
+std::size_t ChainCode::Decoder::getPosition() const
+{
+    return mPosition;
+}
+
+ChainCode::ChainCode(sf::Vector2i worldSize)
+: mTopology(worldSize)
+, mSize(0)
+, mLast()
+{
+}
+
+ChainCode::ChainCode(sf::Vector2i worldSize, const std::vector<sf::Vector2i>& cells)
+: mTopology(worldSize)
+, mSize(0)
+, mLast()
+{
+    mCodes.reserve(cells.size() / CODES_PER_WORD + 1);
+    mCheckpoints.reserve(cells.size() / CHECKPOINT_INTERVAL + 1);
+    for(sf::Vector2i cell : cells)
+        pushBack(cell);
+}
+
+void ChainCode::pushBack(sf::Vector2i cell)
+{
+    std::size_t position = mSize;
+    mSize++;
+
+    if(mCodes.size() * CODES_PER_WORD < mSize)
+        mCodes.push_back(0);
+
+    if(mCheckpoints.empty() || position - mCheckpoints.back().first >= CHECKPOINT_INTERVAL)
+        mCheckpoints.push_back(Checkpoint(position, cell));
+
+    if(position > 0 && encode(position, mLast, cell))
+        mJumps.push_back(Jump(position, cell));
+
+    mLast = cell;
+}
+
+void ChainCode::splice(const SpliceRun* runs, std::size_t runCount, const sf::Vector2i* cells, ScratchArena& arena)
+{
+    if(runCount == 0)
+        return;
+
+    std::size_t size = mSize;
+    std::size_t newSize = getSplicedSize(size, runs, runCount);
+
+    // The cells on both sides of each run are needed to encode it, so decode
+    // them before anything moves. A fresh decoder is only made for runs far
+    // apart.
+    sf::Vector2i* before = arena.allocate<sf::Vector2i>(runCount);
+    sf::Vector2i* after = arena.allocate<sf::Vector2i>(runCount);
+    std::size_t insertCount = 0;
+    Decoder decoder(*this, 0);
+    auto decode = [this, &decoder](std::size_t position)
+    {
+        if(position < decoder.getPosition() || position - decoder.getPosition() > MAX_CHECKPOINT_GAP)
+            decoder = Decoder(*this, position);
+
+        while(decoder.getPosition() < position)
+            ++decoder;
+
+        return *decoder;
+    };
+
+    for(std::size_t i = 0; i < runCount; i++)
+    {
+        const SpliceRun& run = runs[i];
+        assert(i == 0 || run.mPosition > runs[i - 1].mPosition + runs[i - 1].mEraseCount);
+        assert(run.mPosition + run.mEraseCount <= size);
+
+        if(run.mPosition > 0)
+            before[i] = decode(run.mPosition - 1);
+        if(run.mPosition + run.mEraseCount < size)
+            after[i] = decode(run.mPosition + run.mEraseCount);
+
+        insertCount += run.mInsertCount;
+    }
+
+    // The codes of the kept cells still hold, apart from the first after each run.
+    mCodes.resize((std::max(size, newSize) + CODES_PER_WORD - 1) / CODES_PER_WORD);
+    shiftKeptBlocks(size, runs, runCount, [this](std::size_t begin, std::size_t end, std::ptrdiff_t shift)
+    {
+        if(shift < 0)
+        {
+            for(std::size_t i = begin; i < end; i++)
+                setCode(i + shift, getCode(i));
+        }
+        else
+        {
+            for(std::size_t i = end; i-- > begin;)
+                setCode(i + shift, getCode(i));
+        }
+    });
+
+    // Merge the jumps and checkpoints of the kept cells with those of the
+    // cells encoded again, all in order of position.
+    Jump* jumps = arena.allocate<Jump>(mJumps.size() + insertCount + runCount);
+    Checkpoint* checkpoints = arena.allocate<Checkpoint>(mCheckpoints.size() + insertCount / CHECKPOINT_INTERVAL + 2 * runCount);
+    std::size_t jumpCount = 0;
+    std::size_t checkpointCount = 0;
+    std::size_t iJump = 0;
+    std::size_t iCheckpoint = 0;
+    std::ptrdiff_t shift = 0;
+    const sf::Vector2i* cell = cells;
+    for(std::size_t i = 0; i <= runCount; i++)
+    {
+        // The kept block before run i. Its first cell is encoded again if it follows a run.
+        std::size_t begin = i == 0 ? 0 : runs[i - 1].mPosition + runs[i - 1].mEraseCount;
+        std::size_t end = i < runCount ? runs[i].mPosition : size;
+        for(; iJump < mJumps.size() && mJumps[iJump].first < end; iJump++)
+            if(mJumps[iJump].first > begin || (i == 0 && mJumps[iJump].first == begin))
+                jumps[jumpCount++] = Jump(mJumps[iJump].first + shift, mJumps[iJump].second);
+
+        for(; iCheckpoint < mCheckpoints.size() && mCheckpoints[iCheckpoint].first < end; iCheckpoint++)
+            if(mCheckpoints[iCheckpoint].first > begin || (i == 0 && mCheckpoints[iCheckpoint].first == begin))
+                checkpoints[checkpointCount++] = Checkpoint(mCheckpoints[iCheckpoint].first + shift, mCheckpoints[iCheckpoint].second);
+
+        if(i == runCount)
+            break;
+
+        const SpliceRun& run = runs[i];
+        std::size_t position = run.mPosition + shift;
+        sf::Vector2i previous = before[i];
+        for(std::size_t k = 0; k < run.mInsertCount; k++, cell++, position++)
+        {
+            if(k % CHECKPOINT_INTERVAL == 0)
+                checkpoints[checkpointCount++] = Checkpoint(position, *cell);
+            if(position > 0 && encode(position, previous, *cell))
+                jumps[jumpCount++] = Jump(position, *cell);
+
+            previous = *cell;
+        }
+
+        // The first kept cell after the run follows another cell now.
+        shift += std::ptrdiff_t(run.mInsertCount) - std::ptrdiff_t(run.mEraseCount);
+        if(run.mPosition + run.mEraseCount < size)
+        {
+            checkpoints[checkpointCount++] = Checkpoint(position, after[i]);
+            if(position > 0 && encode(position, previous, after[i]))
+                jumps[jumpCount++] = Jump(position, after[i]);
+        }
+        else if(position > 0)
+            mLast = previous;
+    }
+
+    mSize = newSize;
+    mCodes.resize((mSize + CODES_PER_WORD - 1) / CODES_PER_WORD);
+    mJumps.assign(jumps, jumps + jumpCount);
+    checkpointCount = thinCheckpoints(checkpoints, checkpointCount);
+    mCheckpoints.assign(checkpoints, checkpoints + checkpointCount);
+}
+
+void ChainCode::clear()
+{
+    mSize = 0;
+    mLast = sf::Vector2i();
+    mCodes.clear();
+    mJumps.clear();
+    mCheckpoints.clear();
+}
+
+void ChainCode::reserve(std::size_t size)
+{
+    mCodes.reserve(size / CODES_PER_WORD + 1);
+    mJumps.reserve(size / 2 + 1);
+    mCheckpoints.reserve(size / CHECKPOINT_INTERVAL + 1);
+}
+
+sf::Vector2i ChainCode::get(std::size_t position) const
+{
+    assert(position < mSize);
+    return *Decoder(*this, position);
+}
+
+std::size_t ChainCode::getSize() const
+{
+    return mSize;
+}
+
+ChainCode::Decoder ChainCode::getDecoder(std::size_t position) const
+{
+    return Decoder(*this, position);
+}
+
+std::size_t ChainCode::getMemoryUsage() const
+{
+    return  mCodes.capacity() * sizeof(uint64_t)
+            + mJumps.capacity() * sizeof(Jump)
+            + mCheckpoints.capacity() * sizeof(Checkpoint);
+}
+
+unsigned int ChainCode::getCode(std::size_t position) const
+{
+    return (mCodes[position / CODES_PER_WORD] >> (position % CODES_PER_WORD * 3)) & 7;
+}
+
+void ChainCode::setCode(std::size_t position, unsigned int code)
+{
+    unsigned int shift = position % CODES_PER_WORD * 3;
+    uint64_t& word = mCodes[position / CODES_PER_WORD];
+    word = (word & ~(uint64_t(7) << shift)) | (uint64_t(code) << shift);
+}
+
+// Store cell at position, given the cell before it. A jump is only given its
+// placeholder code; the caller puts it in the jump table.
+bool ChainCode::encode(std::size_t position, sf::Vector2i previous, sf::Vector2i cell)
+{
+    assert(position > 0);
+
+    // Take the short way around the world.
+    sf::Vector2i delta = mTopology.getDelta(previous, cell);
+
+    int code = -1;
+    if(delta.x >= -1 && delta.x <= 1 && delta.y >= -1 && delta.y <= 1)
+        code = DIRECTION_CODES[(delta.x + 1) + (delta.y + 1) * 3];
+
+    if(code >= 0)
+    {
+        setCode(position, code);
+        return false;
+    }
+
+    setCode(position, JUMP_CODE);
+    return true;
+}
+
+sf::Vector2i ChainCode::step(sf::Vector2i cell, unsigned int code) const
+{
+    cell.x += DIRECTIONS[code][0];
+    cell.y += DIRECTIONS[code][1];
+    return mTopology.wrapIndex(cell);
+}
+
+// Index of the first jump at or after position.
+std::size_t ChainCode::findJump(std::size_t position) const
+{
+    auto it = std::lower_bound(mJumps.begin(), mJumps.end(), position, [](const Jump& jump, std::size_t p) { return jump.first < p; });
+    return it - mJumps.begin();
+}
+
+const ChainCode::Checkpoint& ChainCode::findCheckpoint(std::size_t position) const
+{
+    auto it = std::upper_bound(mCheckpoints.begin(), mCheckpoints.end(), position, [](std::size_t p, const Checkpoint& checkpoint) { return p < checkpoint.first; });
+    assert(it != mCheckpoints.begin());
+    return *(it - 1);
+}
+
+// Drop every checkpoint that the ones around it make unnecessary, keeping
+// them at most MAX_CHECKPOINT_GAP apart. Any two gaps next to each other
+// then add up to more than that, so there are at most about
+// mSize / CHECKPOINT_INTERVAL left.
+std::size_t ChainCode::thinCheckpoints(Checkpoint* checkpoints, std::size_t count) const
+{
+    std::size_t keptCount = std::min<std::size_t>(count, 1);
+    for(std::size_t i = 1; i < count; i++)
+    {
+        std::size_t next = i + 1 < count ? checkpoints[i + 1].first : mSize;
+        if(next - checkpoints[keptCount - 1].first > MAX_CHECKPOINT_GAP)
+            checkpoints[keptCount++] = checkpoints[i];
+    }
+
+    return keptCount;
+}
@@ -0,0 +1,186 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+////////////////////////////////////////////////
+// Tecto library
+#include <CrustPayload.hpp>
+////////////////////////////////////////////////
+
+namespace
+{
+    uint16_t saturate(int value, unsigned int max)
+    {
+        if(value < 0)
+            return 0;
+        else if(value > static_cast<int>(max))
+            return max;
+
+        return value;
+    }
+
+    uint16_t quantizeTime(unsigned int time)
+    {
+        unsigned int quantized = time / AgePlane::TIME_QUANTUM;
+        return quantized > UINT16_MAX ? UINT16_MAX : quantized;
+    }
+}
+
+HeightPlane::HeightPlane(unsigned int sizeX, unsigned int sizeY, unsigned int height)
+: mHeights(sizeX, sizeY, height > MAX_HEIGHT ? MAX_HEIGHT : height)
+{
+}
+
+void HeightPlane::offsetHeight(std::size_t index, int offset)
+{
+    mHeights[index] = saturate(mHeights[index] + offset, MAX_HEIGHT);
+}
+
+void HeightPlane::setHeight(std::size_t index, unsigned int height)
+{
+    mHeights[index] = height > MAX_HEIGHT ? MAX_HEIGHT : height;
+}
+
+unsigned int HeightPlane::getHeight(std::size_t index) const
+{
+    return mHeights[index];
+}
+
+Grid<uint16_t>& HeightPlane::getHeights()
+{
+    return mHeights;
+}
+
+const Grid<uint16_t>& HeightPlane::getHeights() const
+{
+    return mHeights;
+}
+
+std::size_t HeightPlane::getMemoryUsage() const
+{
+    return mHeights.getCellCount() * sizeof(uint16_t);
+}
+
+ContinentalPlane::ContinentalPlane(std::size_t cellCount, bool isContinental)
+: mContinentalMask((cellCount + 63) / 64, isContinental ? ~uint64_t(0) : 0)
+{
+}
+
+bool ContinentalPlane::isContinental(std::size_t index) const
+{
+    return (mContinentalMask[index / 64] >> (index % 64)) & 1;
+}
+
+void ContinentalPlane::setContinental(std::size_t index, bool flag)
+{
+    uint64_t bit = uint64_t(1) << (index % 64);
+    if(flag)
+        mContinentalMask[index / 64] |= bit;
+    else
+        mContinentalMask[index / 64] &= ~bit;
+}
+
+std::size_t ContinentalPlane::getMemoryUsage() const
+{
+    return mContinentalMask.size() * sizeof(uint64_t);
+}
+
+AgePlane::AgePlane(unsigned int sizeX, unsigned int sizeY, unsigned int time)
+: mTimesCreated(sizeX, sizeY, quantizeTime(time))
+{
+}
+
+void AgePlane::setTimeCreated(std::size_t index, unsigned int time)
+{
+    mTimesCreated[index] = quantizeTime(time);
+}
+
+unsigned int AgePlane::getTimeCreated(std::size_t index) const
+{
+    return mTimesCreated[index] * TIME_QUANTUM;
+}
+
+std::size_t AgePlane::getMemoryUsage() const
+{
+    return mTimesCreated.getCellCount() * sizeof(uint16_t);
+}
+
+SedimentPlane::SedimentPlane(unsigned int sizeX, unsigned int sizeY, unsigned int thickness)
+: mSediments(sizeX, sizeY, thickness > MAX_SEDIMENT ? MAX_SEDIMENT : thickness)
+{
+}
+
+void SedimentPlane::offsetSediment(std::size_t index, int offset)
+{
+    mSediments[index] = saturate(mSediments[index] + offset, MAX_SEDIMENT);
+}
+
+void SedimentPlane::setSediment(std::size_t index, unsigned int thickness)
+{
+    mSediments[index] = thickness > MAX_SEDIMENT ? MAX_SEDIMENT : thickness;
+}
+
+unsigned int SedimentPlane::getSediment(std::size_t index) const
+{
+    return mSediments[index];
+}
+
+std::size_t SedimentPlane::getMemoryUsage() const
+{
+    return mSediments.getCellCount() * sizeof(uint16_t);
+}
+
+PreviewPayload::PreviewPayload(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool, unsigned int)
+: HeightPlane(sizeX, sizeY, height)
+{
+}
+
+std::size_t PreviewPayload::getMemoryUsage() const
+{
+    return HeightPlane::getMemoryUsage();
+}
+
+StandardPayload::StandardPayload(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool isContinental, unsigned int time)
+: HeightPlane(sizeX, sizeY, height)
+, ContinentalPlane(getHeights().getCellCount(), isContinental)
+, AgePlane(sizeX, sizeY, time)
+{
+}
+
+std::size_t StandardPayload::getMemoryUsage() const
+{
+    return  HeightPlane::getMemoryUsage()
+            + ContinentalPlane::getMemoryUsage()
+            + AgePlane::getMemoryUsage();
+}
+
+ResearchPayload::ResearchPayload(unsigned int sizeX, unsigned int sizeY, unsigned int height, bool isContinental, unsigned int time)
+: StandardPayload(sizeX, sizeY, height, isContinental, time)
+, SedimentPlane(sizeX, sizeY, 0)
+{
+}
+
+std::size_t ResearchPayload::getMemoryUsage() const
+{
+    return  StandardPayload::getMemoryUsage()
+            + SedimentPlane::getMemoryUsage();
+}
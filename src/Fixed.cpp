@@ -0,0 +1,103 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Fixed.hpp>
+////////////////////////////////////////////////
+
+namespace
+{
+    const unsigned int QUARTER_BITS = 10;                      // Table entries per quarter turn, as a power of two.
+    const unsigned int QUARTER_SIZE = 1 << QUARTER_BITS;
+    const unsigned int PHASE_BITS = 30;                        // Bits of an Angle within a quarter turn.
+    const unsigned int LERP_BITS = PHASE_BITS - QUARTER_BITS;  // Bits between two table entries.
+
+    // sin of QUARTER_SIZE + 1 evenly spaced angles from 0 to 90 degrees.
+    // Built with a Taylor series in Q2.30, so every platform gets the same table.
+    struct SineTable
+    {
+        SineTable()
+        {
+            const int64_t HALF_PI = 1686629713; // pi / 2 in Q2.30.
+            for(unsigned int i = 0; i <= QUARTER_SIZE; i++)
+            {
+                int64_t x = HALF_PI * i / QUARTER_SIZE;
+                int64_t x2 = (x * x) >> 30;
+                int64_t term = x;
+                int64_t sum = x;
+                for(int k = 1; k <= 8; k++)
+                {
+                    term = -term * x2 / (int64_t(2 * k) * (2 * k + 1)) >> 30;
+                    sum += term;
+                }
+
+                mValues[i] = (sum + (1 << 13)) >> 14;
+            }
+
+            mValues[QUARTER_SIZE + 1] = mValues[QUARTER_SIZE];
+        }
+
+        int32_t mValues[QUARTER_SIZE + 2]; // The last entry lets lookups at 90 degrees interpolate.
+    };
+
+    const SineTable& getSineTable()
+    {
+        static const SineTable table;
+        return table;
+    }
+}
+
+Angle degreesToAngle(Fixed degrees)
+{
+    // 2^32 per 360 degrees, and degrees are scaled by 2^16.
+    return Angle(int64_t(degrees.getRaw()) * 65536 / 360);
+}
+
+float angleToDegrees(Angle angle)
+{
+    return angle * (360.0 / 4294967296.0);
+}
+
+Fixed fixedSin(Angle angle)
+{
+    const int32_t* values = getSineTable().mValues;
+
+    unsigned int quadrant = angle >> PHASE_BITS;
+    uint32_t phase = angle & ((uint32_t(1) << PHASE_BITS) - 1);
+
+    // sin falls back down in the second and fourth quadrants.
+    if(quadrant & 1)
+        phase = (uint32_t(1) << PHASE_BITS) - phase;
+
+    uint32_t index = phase >> LERP_BITS;
+    int64_t fraction = phase & ((uint32_t(1) << LERP_BITS) - 1);
+    int32_t value = values[index] + ((values[index + 1] - values[index]) * fraction >> LERP_BITS);
+
+    return Fixed::fromRaw(quadrant & 2 ? -value : value);
+}
+
+Fixed fixedCos(Angle angle)
+{
+    return fixedSin(angle + (Angle(1) << PHASE_BITS));
+}
@@ -23,9 +23,14 @@
 #include <Lithosphere.hpp>
 #include <Utility.hpp>
 #include <Vector.hpp>
+#include <AllocationCounter.hpp>
 
 ////////////////////////////////////////////////
 // C++ Standard Library
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
 //////////////////////
 // DEBUG
 #include <iostream>
@@ -41,20 +46,76 @@
 
 
 
-Lithosphere::Lithosphere(unsigned int worldSizeX, unsigned int worldSizeY)
-: mIndexOccupancyMap(worldSizeX, std::vector<int8_t>(worldSizeY, 1))
-, mSize(worldSizeX, worldSizeY)
+namespace
 {
-    Crust crust(0);
-    crust.setContinental(true);
+    // Simulated time is counted in whole steps so that every platform
+    // schedules plates alike.
+    const int64_t TIME_STEPS_PER_YEAR = Plate::TIME_STEPS_PER_YEAR;
+    const int64_t NEVER = INT64_MAX;
+    const int64_t MAX_WAIT = 1000 * TIME_STEPS_PER_YEAR; // Longest a plate waits for its next update.
+
+    // Streams of world random numbers, one per kind of draw.
+    enum RandomStream
+    {
+        PLUME_COUNT_STREAM,     // Counters 0, 1 and 2: plumes, share of big and share of medium.
+        PLUME_INDEX_STREAM,     // Counters 2i and 2i + 1: x and y of plume i.
+        PLATE_COUNT_STREAM,     // Counter 0: plates.
+        PLATE_INDEX_STREAM      // Counters (p << 32) | 2i and (p << 32) | (2i + 1): x and y of spawn attempt i of plate p.
+    };
 
-    mHeightmap = std::vector<std::vector<Crust>>(worldSizeX, std::vector<Crust>(worldSizeY, crust));
+    // Time steps it takes to move distance cells at speed cells per year, rounded down.
+#ifdef TECTO_FIXED_POINT
+    int64_t getTimeSteps(Fixed distance, Fixed speed)
+    {
+        if(speed <= 0)
+            return NEVER;
+
+        // Both are in 1/65536ths, which is also the length of a time step.
+        return std::min((int64_t(distance.getRaw()) << Fixed::FRACTION_BITS) / speed.getRaw(), MAX_WAIT);
+    }
+#else
+    int64_t getTimeSteps(float distance, float speed)
+    {
+        if(speed <= 0.f)
+            return NEVER;
+
+        return std::min<double>(double(distance) / speed * TIME_STEPS_PER_YEAR, MAX_WAIT);
+    }
+#endif // TECTO_FIXED_POINT
+}
+
+template <class Payload>
+Lithosphere<Payload>::Lithosphere(unsigned int worldSizeX, unsigned int worldSizeY, uint64_t seed)
+: mHeightmap(worldSizeX, worldSizeY, 100, true, 0)
+, mIndexOccupancyMap(worldSizeX, worldSizeY, 1)
+, mSize(worldSizeX, worldSizeY)
+, mRandom(seed)
+, mTopology(sf::Vector2i(worldSizeX, worldSizeY))
+, mSurface(worldSizeX, worldSizeY)
+, mRasterizer(sf::Vector2i(worldSizeX, worldSizeY))
+, mTime(0)
+, mBoundaryCells((std::size_t(worldSizeX) * worldSizeY + 63) / 64, 0)
+, mTileCountY((worldSizeY + TILE_SIZE - 1) / TILE_SIZE)
+, mTileCount(std::size_t((worldSizeX + TILE_SIZE - 1) / TILE_SIZE) * mTileCountY)
+#ifdef TECTO_ATOMIC_OCCUPANCY
+, mCollisions(mThreadPool.getThreadCount())
+, mEmptyCells(mThreadPool.getThreadCount())
+#else
+, mEmptyCells(nullptr)
+, mEmptyCellCount(0)
+#endif // TECTO_ATOMIC_OCCUPANCY
+#ifdef TECTO_COUNT_ALLOCATIONS
+, mTickCount(0)
+, mAllocationCount(0)
+, mBufferMemoryUsage(0)
+#endif // TECTO_COUNT_ALLOCATIONS
+{
 
     /////////////////////////////////////////////////////////////////////
     // DEBUG
     // Just checkin' the memory size of them crusts.
     std::cout   << "Sizes of different classes..." << std::endl
-                << "Crust: " << sizeof(Crust) << " bytes" << std::endl
+                << "Crust: " << float(mHeightmap.getMemoryUsage()) / mHeightmap.getCellCount() << " bytes" << std::endl
                 << "BorderCrust: " << sizeof(BorderCrust) << " bytes" << std::endl;
     /////////////////////////////////////////////////////////////////////
 
@@ -66,41 +127,51 @@ Lithosphere::Lithosphere(unsigned int worldSizeX, unsigned int worldSizeY)
     int halfWorldSizeX = worldSizeX/2;
     int halfWorldSizeY = worldSizeY/2;
 
-    std::list<BorderCrust> border;
+    std::vector<BorderCrust> border;
 
 
-    auto initBorder = [](std::list<BorderCrust>& border, int top, int right, int bot, int left, std::vector<std::vector<Crust>>& heightmap)
+    auto initBorder = [](std::vector<BorderCrust>& border, int top, int right, int bot, int left, const CrustMap<Payload>& heightmap, uint16_t plate)
     {
         for(int x = left; x < right; x++)
-            border.push_back(BorderCrust(sf::Vector2i(x, top), heightmap[x][top]));
+            border.push_back(BorderCrust(sf::Vector2i(x, top), heightmap.getHandle(x, top, plate)));
 
         for(int y = top; y < bot; y++)
-            border.push_back(BorderCrust(sf::Vector2i(right, y), heightmap[right][y]));
+            border.push_back(BorderCrust(sf::Vector2i(right, y), heightmap.getHandle(right, y, plate)));
 
         for(int x = right; x > left; x--)
-            border.push_back(BorderCrust(sf::Vector2i(x, bot), heightmap[x][bot]));
+            border.push_back(BorderCrust(sf::Vector2i(x, bot), heightmap.getHandle(x, bot, plate)));
 
         for(int y = bot; y > top; y--)
-            border.push_back(BorderCrust(sf::Vector2i(left, y), heightmap[left][y]));
+            border.push_back(BorderCrust(sf::Vector2i(left, y), heightmap.getHandle(left, y, plate)));
+    };
+
+    auto initCells = [worldSizeY](int top, int right, int bot, int left)
+    {
+        CellSet cells;
+        for(int x = left; x <= right; x++)
+            cells.insertRange(x * worldSizeY + top, x * worldSizeY + bot + 1);
+
+        return cells;
     };
+
     // Top-left plate
-    initBorder(border, 1, halfWorldSizeX, halfWorldSizeY, 1, mHeightmap);
-    mPlates.push_back(std::unique_ptr<Plate>(new Plate(mHeightmap, worldSize, border)));
+    initBorder(border, 1, halfWorldSizeX, halfWorldSizeY, 1, mHeightmap, mPlates.size());
+    mPlates.push_back(std::unique_ptr<Plate>(new Plate(worldSize, border, initCells(1, halfWorldSizeX, halfWorldSizeY, 1))));
     border.clear();
 
     // Top-right plate
-    initBorder(border, 1, worldSizeX - 1, halfWorldSizeY, halfWorldSizeX, mHeightmap);
-    mPlates.push_back(std::unique_ptr<Plate>(new Plate(mHeightmap, worldSize, border)));
+    initBorder(border, 1, worldSizeX - 1, halfWorldSizeY, halfWorldSizeX, mHeightmap, mPlates.size());
+    mPlates.push_back(std::unique_ptr<Plate>(new Plate(worldSize, border, initCells(1, worldSizeX - 1, halfWorldSizeY, halfWorldSizeX))));
     border.clear();
 
     // Bottom-left plate
-    initBorder(border, halfWorldSizeY, halfWorldSizeX, worldSizeY - 1, 1, mHeightmap);
-    mPlates.push_back(std::unique_ptr<Plate>(new Plate(mHeightmap, worldSize, border)));
+    initBorder(border, halfWorldSizeY, halfWorldSizeX, worldSizeY - 1, 1, mHeightmap, mPlates.size());
+    mPlates.push_back(std::unique_ptr<Plate>(new Plate(worldSize, border, initCells(halfWorldSizeY, halfWorldSizeX, worldSizeY - 1, 1))));
     border.clear();
 
     // Bottom-right plate
-    initBorder(border, halfWorldSizeY, worldSizeX - 1, worldSizeY - 1, halfWorldSizeX, mHeightmap);
-    mPlates.push_back(std::unique_ptr<Plate>(new Plate(mHeightmap, worldSize, border)));
+    initBorder(border, halfWorldSizeY, worldSizeX - 1, worldSizeY - 1, halfWorldSizeX, mHeightmap, mPlates.size());
+    mPlates.push_back(std::unique_ptr<Plate>(new Plate(worldSize, border, initCells(halfWorldSizeY, worldSizeX - 1, worldSizeY - 1, halfWorldSizeX))));
 
 
   //  for(PlatePtr& pPlate : mPlates)
@@ -109,21 +180,35 @@ Lithosphere::Lithosphere(unsigned int worldSizeX, unsigned int worldSizeY)
         mPlates[3]->setRotationalVelocity(0.05f);
     }
 
+    // Reserve room for every plate being scheduled twice, so that ticks do not allocate.
+    mSchedule.reserve(mPlates.size() * 2);
+    mDueTimes.assign(mPlates.size(), NEVER);
+    mUpdateTimes.assign(mPlates.size(), 0);
+    mDuePlates.reserve(mPlates.size());
+    for(std::size_t i = 0; i < mPlates.size(); i++)
+        schedulePlate(i);
+
+    for(std::size_t i = 0; i < mPlates.size(); i++)
+        mRasterizer.rasterize(i, *mPlates[i], mHeightmap.getHeights(), mSurface, &mThreadPool);
+
     initializeDrawMap();
+    mRasterizer.clearDirtySpans();
 
 
     std::cout   << "Memory report (kB)" << std::endl;
 
     for(int i = 0; i < mPlates.size(); i++)
-        std::cout   << "Plate border " << i << ": " << sizeof(BorderCrust) * mPlates[i]->getBorderCrustCount() / 1000 << std::endl
-                    << "Plate draw map " << i << ": " << sizeof(sf::Vertex) * mPlates[i]->getBorderCrustCount() / 1000 << std::endl;
+        std::cout   << "Plate border " << i << ": " << mPlates[i]->getBorder().getMemoryUsage() / 1000 << std::endl
+                    << "Plate draw map " << i << ": " << sizeof(sf::Vertex) * mPlates[i]->getBorderCrustCount() / 1000 << std::endl
+                    << "Plate cells " << i << ": " << mPlates[i]->getCells().getMemoryUsage() / 1000 << std::endl;
 
-    std::cout   << "Heightmap: " << sizeof(mHeightmap) * mSize.x * mSize.y / 1000 << std::endl
+    std::cout   << "Heightmap: " << mHeightmap.getMemoryUsage() / 1000 << std::endl
                 << "Draw map: " << sizeof(sf::Vertex) * mSize.x * mSize.y / 1000 << std::endl
-                << "Occupancy map: " << sizeof(mIndexOccupancyMap) * mSize.x * mSize.y / 1000 << std::endl;
+                << "Occupancy map: " << mIndexOccupancyMap.getMemoryUsage() / 1000 << std::endl;
 }
 
-void Lithosphere::initializePlumes(sf::Vector2u worldSize)
+template <class Payload>
+void Lithosphere<Payload>::initializePlumes(sf::Vector2u worldSize)
 {
     // Big plume
     Plume plume(sf::Vector2i(0, 0), 20, 100);
@@ -140,11 +225,8 @@ void Lithosphere::initializePlumes(sf::Vector2u worldSize)
     mPlumeTypes.push_back(plume);
 
 
-    // Initialize seed.
-    std::srand(time(NULL));
-
     // Randomize number of plumes between 30 and 70. Earth has roughly 50.
-    int nPlumes = std::rand() % 40 + 30;
+    int nPlumes = mRandom.get(PLUME_COUNT_STREAM, 0, 40) + 30;
 
     /*
      * Randomize the distribution of three different plume sizes. Earth's is roughly 19% big, 25% medium and 56% small.
@@ -153,10 +235,10 @@ void Lithosphere::initializePlumes(sf::Vector2u worldSize)
      */
 
     // Percentage of big plumes: 15-25%
-    int nBigPlumes = (std::rand() % 10 + 15) / 100.f * nPlumes;
+    int nBigPlumes = (mRandom.get(PLUME_COUNT_STREAM, 1, 10) + 15) / 100.f * nPlumes;
 
     // Percentage of medium plumes: 20-30%
-    int nMediumPlumes = (std::rand() % 10 + 20) / 100.f * nPlumes;
+    int nMediumPlumes = (mRandom.get(PLUME_COUNT_STREAM, 2, 10) + 20) / 100.f * nPlumes;
 
     // The rest of the plumes get to be small plumes.
     // Percentage of small plumes: 45-65%
@@ -189,8 +271,8 @@ void Lithosphere::initializePlumes(sf::Vector2u worldSize)
     plume = mPlumeTypes[0];
     for(int i = 0; i < nBigPlumes; i++)
     {
-        index.x = std::rand() % worldSize.x;
-        index.y = std::rand() % worldSize.y;
+        index.x = mRandom.get(PLUME_INDEX_STREAM, 2 * mPlumes.size(), worldSize.x);
+        index.y = mRandom.get(PLUME_INDEX_STREAM, 2 * mPlumes.size() + 1, worldSize.y);
 
         plume.mIndex = index;
         mPlumes.push_back(plume);
@@ -200,8 +282,8 @@ void Lithosphere::initializePlumes(sf::Vector2u worldSize)
      plume = mPlumeTypes[1];
      for(int i = 0; i < nMediumPlumes; i++)
      {
-         index.x = std::rand() % worldSize.x;
-         index.y = std::rand() % worldSize.y;
+         index.x = mRandom.get(PLUME_INDEX_STREAM, 2 * mPlumes.size(), worldSize.x);
+         index.y = mRandom.get(PLUME_INDEX_STREAM, 2 * mPlumes.size() + 1, worldSize.y);
 
          plume.mIndex = index;
          mPlumes.push_back(plume);
@@ -211,22 +293,23 @@ void Lithosphere::initializePlumes(sf::Vector2u worldSize)
      plume = mPlumeTypes[2];
      for(int i = 0; i < nSmallPlumes; i++)
      {
-         index.x = std::rand() % worldSize.x;
-         index.y = std::rand() % worldSize.y;
+         index.x = mRandom.get(PLUME_INDEX_STREAM, 2 * mPlumes.size(), worldSize.x);
+         index.y = mRandom.get(PLUME_INDEX_STREAM, 2 * mPlumes.size() + 1, worldSize.y);
 
          plume.mIndex = index;
          mPlumes.push_back(plume);
      }
+
+    initializePlumeShapes();
 }
 
-void Lithosphere::initializePlates(sf::Vector2u worldSize)
+template <class Payload>
+void Lithosphere<Payload>::initializePlates(sf::Vector2u worldSize)
 {
     std::vector<Vectori> border;
 
 
-    std::srand(time(NULL));
-
-    int nPlates = rand() % 6 + 5; // 5-10
+    int nPlates = mRandom.get(PLATE_COUNT_STREAM, 0, 6) + 5; // 5-10
 
 
     Vectoru wSize(worldSize.x, worldSize.y);
@@ -237,10 +320,13 @@ void Lithosphere::initializePlates(sf::Vector2u worldSize)
         const Vectoru spawnAreaMin = wSize * 1/5;
 
         sf::Vector2u heightmapIndex;
+        uint64_t attempt = 0;
         do
         {
-            heightmapIndex.x = rand() % spawnAreaMax.x + spawnAreaMin.x;
-            heightmapIndex.y = rand() % spawnAreaMax.y + spawnAreaMin.y;
+            uint64_t counter = (uint64_t(i) << 32) | 2 * attempt;
+            heightmapIndex.x = mRandom.get(PLATE_INDEX_STREAM, counter, spawnAreaMax.x) + spawnAreaMin.x;
+            heightmapIndex.y = mRandom.get(PLATE_INDEX_STREAM, counter + 1, spawnAreaMax.y) + spawnAreaMin.y;
+            attempt++;
         } while(true);
 
 
@@ -449,17 +535,130 @@ THIS
 }
 
 
-void Lithosphere::update(float years)
+template <class Payload>
+void Lithosphere<Payload>::update(float years)
 {
-    //for(PlatePtr& plate : mPlates)
-    //    plate->update(years);
+    // A long span is simulated in ticks of at most MAX_WAIT, so that no plate
+    // is more than two of them behind.
+    int64_t timeSteps = std::llround(double(years) * TIME_STEPS_PER_YEAR);
+    for(; timeSteps > MAX_WAIT; timeSteps -= MAX_WAIT)
+        tick(MAX_WAIT);
+
+    tick(timeSteps);
+}
+
+template <class Payload>
+void Lithosphere<Payload>::tick(int64_t timeSteps)
+{
+    mTime += timeSteps;
+
+    mDuePlates.clear();
+    while(!mSchedule.empty() && mSchedule.front().first <= mTime)
+    {
+        std::pop_heap(mSchedule.begin(), mSchedule.end(), std::greater<ScheduledPlate>());
+        ScheduledPlate due = mSchedule.back();
+        mSchedule.pop_back();
+
+        // A plate that was scheduled again before its due time has one
+        // entry per schedulePlate(). Only the first one of a time counts.
+        if(due.first == mDueTimes[due.second])
+        {
+            mDueTimes[due.second] = NEVER;
+            mDuePlates.push_back(due.second);
+        }
+    }
+
+    // Same order as if every plate was updated.
+    std::sort(mDuePlates.begin(), mDuePlates.end());
+    assert(std::adjacent_find(mDuePlates.begin(), mDuePlates.end()) == mDuePlates.end());
+
+    // A plate catches up on all the years since it was last updated.
+    auto updatePlate = [this](std::size_t i)
+    {
+        std::size_t plate = mDuePlates[i];
+        assert(mTime - mUpdateTimes[plate] <= 2 * MAX_WAIT);
+        mPlates[plate]->update(mTime - mUpdateTimes[plate], mThreadPool);
+        mUpdateTimes[plate] = mTime;
+#ifdef TECTO_ATOMIC_OCCUPANCY
+        occupyCells(plate);
+#endif // TECTO_ATOMIC_OCCUPANCY
+    };
+    mThreadPool.forEach(mDuePlates.size(), updatePlate);
 
-    mPlates[3]->update(years);
-    //initializeDrawMap();
     handlePlateMovement();
+
+    // Only plates that have moved need to be drawn again.
+    for(std::size_t plate : mDuePlates)
+    {
+        mRasterizer.rasterize(plate, *mPlates[plate], mHeightmap.getHeights(), mSurface, &mThreadPool);
+        mPlates[plate]->resetScratch();
+        schedulePlate(plate);
+    }
+    refreshDrawMap();
+
+#ifdef TECTO_COUNT_ALLOCATIONS
+    // A tick may only touch the heap to grow one of its buffers, which happens
+    // when a border has stretched or a long tick moved more cells than any
+    // before it. Anything else is a bug, in release builds too.
+    std::size_t allocationCount = getAllocationCount();
+    std::size_t bufferMemoryUsage = getBufferMemoryUsage();
+    if(allocationCount != mAllocationCount && bufferMemoryUsage == mBufferMemoryUsage)
+    {
+        std::cerr   << "Tick " << mTickCount << " allocated " << allocationCount - mAllocationCount
+                    << " times without growing any buffer." << std::endl;
+        std::abort();
+    }
+
+    mAllocationCount = allocationCount;
+    mBufferMemoryUsage = bufferMemoryUsage;
+    mTickCount++;
+#endif // TECTO_COUNT_ALLOCATIONS
+}
+
+#ifdef TECTO_COUNT_ALLOCATIONS
+template <class Payload>
+std::size_t Lithosphere<Payload>::getBufferMemoryUsage() const
+{
+    std::size_t usage = mDuePlates.capacity() * sizeof(std::size_t) + mSchedule.capacity() * sizeof(ScheduledPlate) + mMovementArena.getMemoryUsage() + mRasterizer.getMemoryUsage();
+    for(const PlatePtr& plate : mPlates)
+        usage += plate->getMemoryUsage();
+
+#ifdef TECTO_ATOMIC_OCCUPANCY
+    for(const std::vector<CellMove>& collisions : mCollisions)
+        usage += collisions.capacity() * sizeof(CellMove);
+
+    for(const std::vector<sf::Vector2i>& emptyCells : mEmptyCells)
+        usage += emptyCells.capacity() * sizeof(sf::Vector2i);
+#endif // TECTO_ATOMIC_OCCUPANCY
+
+    return usage;
+}
+#endif // TECTO_COUNT_ALLOCATIONS
+
+template <class Payload>
+void Lithosphere<Payload>::schedulePlate(std::size_t plate)
+{
+    // A plate whose border is not in its cells yet is due on the next tick.
+    int64_t wait = getTimeSteps(mPlates[plate]->getCrossingMargin(), mPlates[plate]->getMaxSpeed());
+    if(wait == NEVER)
+    {
+        mDueTimes[plate] = NEVER; // Standing still. Wait until it is scheduled again.
+        return;
+    }
+
+    // A plate that was standing still has not moved since it stopped, so it
+    // starts from now rather than catching up on the time it stood.
+    if(mDueTimes[plate] == NEVER)
+        mUpdateTimes[plate] = mTime;
+
+    // The margin is from where the plate was at its last update.
+    mDueTimes[plate] = std::max(mUpdateTimes[plate] + wait, mTime + 1);
+    mSchedule.push_back(ScheduledPlate(mDueTimes[plate], plate));
+    std::push_heap(mSchedule.begin(), mSchedule.end(), std::greater<ScheduledPlate>());
 }
 
-void Lithosphere::draw(sf::RenderWindow& window) const
+template <class Payload>
+void Lithosphere<Payload>::draw(sf::RenderWindow& window) const
 {
 
 
@@ -472,7 +671,60 @@ void Lithosphere::draw(sf::RenderWindow& window) const
     //mPlates[1]->draw(window);
 }
 
-void Lithosphere::handlePlateMovement()
+// Sort the moves by the tile of the cell they move onto, keeping their
+// order, and call handle(move) for each tile on its own thread. Tiles share
+// no cells, so they can be handled at the same time. The moves that
+// isSerial(move) picks are copied to serialMoves instead, which has room for
+// all moves. Returns how many that is.
+template <class Payload> template <class IsSerial, class Handle>
+std::size_t Lithosphere<Payload>::forEachTile(const CellMove* moves, std::size_t moveCount, IsSerial& isSerial, Handle& handle, CellMove* serialMoves)
+{
+    std::size_t* tileStarts = mMovementArena.allocate<std::size_t>(mTileCount + 1);
+    std::fill(tileStarts, tileStarts + mTileCount + 1, 0);
+    std::size_t serialCount = 0;
+    for(std::size_t i = 0; i < moveCount; i++)
+    {
+        if(isSerial(moves[i]))
+            serialCount++;
+        else
+            tileStarts[getTile(moves[i].mStep.mIndex) + 1]++;
+    }
+
+    std::size_t* busyTiles = mMovementArena.allocate<std::size_t>(mTileCount);
+    std::size_t busyTileCount = 0;
+    for(std::size_t tile = 0; tile < mTileCount; tile++)
+    {
+        if(tileStarts[tile + 1] > 0)
+            busyTiles[busyTileCount++] = tile;
+
+        tileStarts[tile + 1] += tileStarts[tile];
+    }
+
+    CellMove* tileMoves = mMovementArena.allocate<CellMove>(moveCount - serialCount);
+    std::size_t* tileEnds = mMovementArena.allocate<std::size_t>(mTileCount);
+    std::copy(tileStarts, tileStarts + mTileCount, tileEnds);
+    serialCount = 0;
+    for(std::size_t i = 0; i < moveCount; i++)
+    {
+        if(isSerial(moves[i]))
+            serialMoves[serialCount++] = moves[i];
+        else
+            tileMoves[tileEnds[getTile(moves[i].mStep.mIndex)]++] = moves[i];
+    }
+
+    auto handleTile = [tileMoves, tileStarts, busyTiles, &handle](std::size_t i)
+    {
+        std::size_t tile = busyTiles[i];
+        for(std::size_t iMove = tileStarts[tile]; iMove < tileStarts[tile + 1]; iMove++)
+            handle(tileMoves[iMove]);
+    };
+    mThreadPool.forEach(busyTileCount, handleTile);
+
+    return serialCount;
+}
+
+template <class Payload>
+void Lithosphere<Payload>::handlePlateMovement()
 {
     /*
     // Note that the order of the subvectors are the same as their respective parent plates in mPlates.
@@ -488,32 +740,145 @@ void Lithosphere::handlePlateMovement()
 */
     ///////////////////////////////////////
     // Update occupancy map.
+#ifdef TECTO_ATOMIC_OCCUPANCY
+    // The plates have claimed and left their cells as they moved. A cell
+    // that became empty may have been claimed again since.
+    mMovementArena.reset();
+
+    std::size_t collisionCount = 0;
+    for(const std::vector<CellMove>& threadCollisions : mCollisions)
+        collisionCount += threadCollisions.size();
+
+    CellMove* collisions = mMovementArena.allocate<CellMove>(collisionCount);
+    collisionCount = 0;
+    for(std::vector<CellMove>& threadCollisions : mCollisions)
+    {
+        collisionCount = std::copy(threadCollisions.begin(), threadCollisions.end(), collisions + collisionCount) - collisions;
+        threadCollisions.clear();
+    }
 
-    // Crusts that move onto an index not occupied by its plate.
-    // I.e. the frontal crusts of the plate.
-    // Incrementing the occupancy map at the index it has moved to.
-    for(PlatePtr& plate : mPlates)
+    // A collision leaves the cell the crust came from, so one that reaches
+    // into another tile is solved after the tiles.
+    CellMove* crossingCollisions = mMovementArena.allocate<CellMove>(collisionCount);
+    auto isCrossing = [this](const CellMove& collision)
     {
-        const std::vector<BorderCrust*>& newCrusts = plate->getNewCrustIndices();
-        for(int i = 0; newCrusts[i] != nullptr; i++)
-        {
-            BorderCrust* pCrust = newCrusts[i];
-            sf::Vector2i index = pCrust->getIndex();
-            mIndexOccupancyMap[index.x][index.y]++;
+        return getTile(collision.mStep.mIndex) != getTile(collision.mStep.mOriginalIndex);
+    };
+    auto solve = [this](const CellMove& collision)
+    {
+        solveCollision(*mPlates[collision.mPlate], collision.mStep);
+    };
+    std::size_t crossingCount = forEachTile(collisions, collisionCount, isCrossing, solve, crossingCollisions);
 
-            if(mIndexOccupancyMap[index.x][index.y] > 1)
-                solveCollision(pCrust, i);
+    for(std::size_t i = 0; i < crossingCount; i++)
+        solve(crossingCollisions[i]);
+
+    for(std::vector<sf::Vector2i>& emptyCells : mEmptyCells)
+    {
+        for(sf::Vector2i index : emptyCells)
+            if(mIndexOccupancyMap.getCount(index.x, index.y) < 1)
+                populateEmptyIndex(index);
+
+        emptyCells.clear();
+    }
+#else
+    mMovementArena.reset();
+
+    // Every cell move in the order a serial update would make them: plate by
+    // plate, the cells each plate has moved onto and then the cells it has left.
+    std::size_t moveCount = 0;
+    for(std::size_t iPlate : mDuePlates)
+        moveCount += mPlates[iPlate]->getNewCrustIndices().size() + mPlates[iPlate]->getOldCrustIndices().size();
+
+    CellMove* moves = mMovementArena.allocate<CellMove>(moveCount);
+    mEmptyCells = mMovementArena.allocate<sf::Vector2i>(moveCount);
+    mEmptyCellCount = 0;
+    std::size_t iMove = 0;
+    for(std::size_t iPlate : mDuePlates)
+    {
+        for(const CrustStep& step : mPlates[iPlate]->getNewCrustIndices())
+            moves[iMove++] = CellMove{step, uint32_t(iPlate), true};
+
+        for(sf::Vector2i index : mPlates[iPlate]->getOldCrustIndices())
+            moves[iMove++] = CellMove{CrustStep{index, index, CrustHandle()}, uint32_t(iPlate), false};
+    }
+
+    // A move onto a cell may also change the cell its crust came from. If
+    // that cell is in another tile, both cells are boundary cells, and so is
+    // every cell that shares a move with a boundary cell. Each link is a cell
+    // in the upper 32 bits and a move of it in the lower, so that the moves
+    // of a cell are found by binary search once the links are sorted.
+    uint64_t* links = mMovementArena.allocate<uint64_t>(2 * moveCount);
+    sf::Vector2i* spreadCells = mMovementArena.allocate<sf::Vector2i>(2 * moveCount); // Boundary cells not yet spread from.
+    std::size_t linkCount = 0;
+    std::size_t spreadCellCount = 0;
+    auto getCell = [this](sf::Vector2i index)
+    {
+        return uint64_t(index.x) * mSize.y + index.y;
+    };
+    auto addBoundaryCell = [this, spreadCells, &spreadCellCount](sf::Vector2i index)
+    {
+        if(isBoundaryCell(index))
+            return;
+
+        setBoundaryCell(index, true);
+        spreadCells[spreadCellCount++] = index;
+    };
+
+    for(std::size_t i = 0; i < moveCount; i++)
+    {
+        const CrustStep& step = moves[i].mStep;
+        if(step.mIndex == step.mOriginalIndex)
+            continue;
+
+        links[linkCount++] = getCell(step.mIndex) << 32 | i;
+        links[linkCount++] = getCell(step.mOriginalIndex) << 32 | i;
+        if(getTile(step.mIndex) != getTile(step.mOriginalIndex))
+        {
+            addBoundaryCell(step.mIndex);
+            addBoundaryCell(step.mOriginalIndex);
         }
+    }
+    std::sort(links, links + linkCount);
 
-        const std::vector<sf::Vector2i>& oldCrusts = plate->getOldCrustIndices();
-        for(sf::Vector2i index : oldCrusts)
+    // Every cell is spread from once.
+    while(spreadCellCount > 0)
+    {
+        sf::Vector2i index = spreadCells[--spreadCellCount];
+        uint64_t cell = getCell(index);
+        for(const uint64_t* link = std::lower_bound(links, links + linkCount, cell << 32); link != links + linkCount && *link >> 32 == cell; link++)
         {
-            mIndexOccupancyMap[index.x][index.y]--;
-            if(mIndexOccupancyMap[index.x][index.y] < 1)
-                populateEmptyIndex(index);
+            const CrustStep& step = moves[*link & 0xffffffff].mStep;
+            addBoundaryCell(step.mIndex == index ? step.mOriginalIndex : step.mIndex);
         }
+    }
+
+    // The other moves are handled a tile at a time.
+    CellMove* boundaryMoves = mMovementArena.allocate<CellMove>(moveCount);
+    auto isBoundaryMove = [this](const CellMove& move)
+    {
+        return isBoundaryCell(move.mStep.mIndex);
+    };
+    auto handleMove = [this](const CellMove& move)
+    {
+        applyMove(move);
+    };
+    std::size_t boundaryMoveCount = forEachTile(moves, moveCount, isBoundaryMove, handleMove, boundaryMoves);
 
+    for(std::size_t i = 0; i < boundaryMoveCount; i++)
+    {
+        applyMove(boundaryMoves[i]);
+        setBoundaryCell(boundaryMoves[i].mStep.mIndex, false);
+        setBoundaryCell(boundaryMoves[i].mStep.mOriginalIndex, false);
     }
+
+    // If no crusts occupy index, populate it with fresh, delicious crust.
+    // Every cell is occupied after a tick, so only the cells left during
+    // this one can be empty. A cell may have been taken again since.
+    for(std::size_t i = 0; i < mEmptyCellCount; i++)
+        if(mIndexOccupancyMap.getCount(mEmptyCells[i].x, mEmptyCells[i].y) < 1)
+            populateEmptyIndex(mEmptyCells[i]);
+#endif // TECTO_ATOMIC_OCCUPANCY
 /*
     for(auto plateIndices : newIndices)
         for(int i = 0; plateIndices[i] != nullptr; i++)
@@ -550,44 +915,119 @@ void Lithosphere::handlePlateMovement()
 
 
 
-void Lithosphere::solveCollision(BorderCrust* pCrust, int plateIndex)
+// Crusts that move onto a cell already taken collide. The cell a crust has
+// left loses it.
+template <class Payload>
+void Lithosphere<Payload>::applyMove(const CellMove& move)
 {
-    //mPlates[plateIndex]->offsetHeight(pCrust->getSourceCrust().getIndex(), 1);
-    sf::Vector2i index = pCrust->getOriginalIndex();
-    Crust& sourceCrust = pCrust->getSourceCrust();
-    sourceCrust.offsetHeight(100);
+    const CrustStep& step = move.mStep;
+    if(!move.mIsOnto)
+        leaveCell(step.mIndex);
+    else if(mIndexOccupancyMap.increment(step.mIndex.x, step.mIndex.y) > 1)
+        solveCollision(*mPlates[move.mPlate], step);
+}
 
-    int iDrawMap = index.x * mSize.y + index.y;
-    mDrawMap[iDrawMap].color.g = sourceCrust.getHeight() > 255 ? 255 : sourceCrust.getHeight();
-    mIndexOccupancyMap[index.x][index.y]--;
+#ifdef TECTO_ATOMIC_OCCUPANCY
+// Claim the cells plate has moved onto and leave the cells it has left, on
+// the thread that moved it. Collisions change cells that other plates may be
+// using, so they are only noted here.
+template <class Payload>
+void Lithosphere<Payload>::occupyCells(std::size_t plate)
+{
+    std::vector<CellMove>& collisions = mCollisions[mThreadPool.getThreadIndex()];
+    for(const CrustStep& step : mPlates[plate]->getNewCrustIndices())
+        if(mIndexOccupancyMap.increment(step.mIndex.x, step.mIndex.y) > 1)
+            collisions.push_back(CellMove{step, uint32_t(plate), true});
 
-/*    int crustCount = mIndexOccupancyMap[index.x][index.y];
-    std::vector<unsigned int> plates;
+    for(sf::Vector2i index : mPlates[plate]->getOldCrustIndices())
+        leaveCell(index);
+}
+#endif // TECTO_ATOMIC_OCCUPANCY
 
-    int found = 0;
-    for(int i = 0; i < mPlates.size(); i++)
-    {
+// Each cell move leaves at most one cell, so the default list has room.
+template <class Payload>
+void Lithosphere<Payload>::leaveCell(sf::Vector2i index)
+{
+    if(mIndexOccupancyMap.decrement(index.x, index.y) >= 1)
+        return;
+
+#ifdef TECTO_ATOMIC_OCCUPANCY
+    mEmptyCells[mThreadPool.getThreadIndex()].push_back(index);
+#else
+    mEmptyCells[mEmptyCellCount.fetch_add(1, std::memory_order_relaxed)] = index;
+#endif // TECTO_ATOMIC_OCCUPANCY
+}
+
+template <class Payload>
+std::size_t Lithosphere<Payload>::getTile(sf::Vector2i index) const
+{
+    return std::size_t(index.x / TILE_SIZE) * mTileCountY + index.y / TILE_SIZE;
+}
 
-        int plateCrustCount = mPlates[i]->getCrustCount(index);
+template <class Payload>
+bool Lithosphere<Payload>::isBoundaryCell(sf::Vector2i index) const
+{
+    std::size_t cell = std::size_t(index.x) * mSize.y + index.y;
+    return (mBoundaryCells[cell / 64] >> (cell % 64)) & 1;
+}
 
-        if(plateCrustCount > 0)
-        {
-            crustCount += plateCrustCount;
-            plates.push_back(i);
-        }
+template <class Payload>
+void Lithosphere<Payload>::setBoundaryCell(sf::Vector2i index, bool isBoundary)
+{
+    std::size_t cell = std::size_t(index.x) * mSize.y + index.y;
+    uint64_t bit = uint64_t(1) << (cell % 64);
+    mBoundaryCells[cell / 64] = isBoundary ? mBoundaryCells[cell / 64] | bit : mBoundaryCells[cell / 64] & ~bit;
+}
 
-        if(found == crustCount)
+template <class Payload>
+void Lithosphere<Payload>::solveCollision(Plate& plate, const CrustStep& step)
+{
+    sf::Vector2i index = step.mOriginalIndex;
+    leaveCell(index);
+
+    // Only crust pushed into another plate piles up. The cell may also be
+    // shared with crust of the same plate.
+    bool isInsideOtherPlate = false;
+    for(const PlatePtr& other : mPlates)
+    {
+        if(other.get() != &plate && other->getCrustCount(step.mIndex) > 0)
+        {
+            isInsideOtherPlate = true;
             break;
+        }
     }
 
-    if(plates.size() > 1)
+    if(!isInsideOtherPlate)
+        return;
+
+    // The plate is rasterized after its collisions, so refreshDrawMap() shows the new height.
+    mHeightmap[step.mSourceCrust].offsetHeight(100);
+}
+
+template <class Payload>
+sf::Vector2i Lithosphere<Payload>::fitIndexToHeightmap(sf::Vector2i index) const
+{
+    return mTopology.wrapIndex(index);
+}
+
+// Show the cells that the plates drawn this tick have left or covered.
+template <class Payload>
+void Lithosphere<Payload>::refreshDrawMap()
+{
+    for(const PlateRasterizer::Span& span : mRasterizer.getDirtySpans())
     {
-        mPlates[plates[1]]->offsetHeight(index, 1);
-        mIndexOccupancyMap[index.x][index.y] = 1;
-    }*/
+        mRasterizer.forEachCell(span, [this](int x, int y)
+        {
+            unsigned int height = mSurface(x, y);
+            mDrawMap[x * mSize.y + y].color.g = height > 255 ? 255 : height;
+        });
+    }
+
+    mRasterizer.clearDirtySpans();
 }
 
-void Lithosphere::initializeDrawMap()
+template <class Payload>
+void Lithosphere<Payload>::initializeDrawMap()
 {
     mDrawMap.clear();
     mDrawMap.resize(mSize.x * mSize.y);
@@ -596,13 +1036,15 @@ void Lithosphere::initializeDrawMap()
     vertex.color = sf::Color(0, 0, 0);
 
     unsigned int mapIndex = 0;
-    for(int x = 0; x < mSize.x; x++)
+    for(unsigned int x = 0; x < mSize.x; x++)
     {
-        for(int y = 0; y < mSize.y; y++)
+        Grid<uint16_t>::Column column = mSurface.getColumn(x);
+        for(unsigned int y = 0; y < column.getSize(); y++)
         {
+            unsigned int height = column[y];
             vertex.position.x = x;
             vertex.position.y = y;
-            vertex.color.g = mHeightmap[x][y].getHeight() > 255 ? 255 : mHeightmap[x][y].getHeight();
+            vertex.color.g = height > 255 ? 255 : height;
             mDrawMap[mapIndex] = vertex;
             mapIndex++;
         }
@@ -610,14 +1052,24 @@ void Lithosphere::initializeDrawMap()
 }
 
 
-void Lithosphere::populateEmptyIndex(sf::Vector2i index)
+template <class Payload>
+void Lithosphere<Payload>::populateEmptyIndex(sf::Vector2i index)
 {
+    mIndexOccupancyMap.setCount(index.x, index.y, 1);
+}
 
+template <class Payload>
+void Lithosphere<Payload>::drawPlumes(sf::RenderWindow& window) const
+{
+    window.draw(mPlumeShapes);
 }
 
-void Lithosphere::drawPlumes(sf::RenderWindow& window) const
+template <class Payload>
+void Lithosphere<Payload>::initializePlumeShapes()
 {
-    sf::VertexArray plumes(sf::Quads, mPlumes.size() * 4);
+    sf::VertexArray& plumes = mPlumeShapes;
+    plumes.setPrimitiveType(sf::Quads);
+    plumes.resize(mPlumes.size() * 4);
 
     sf::Vertex v;
     v.color = sf::Color::Red;
@@ -649,11 +1101,32 @@ void Lithosphere::drawPlumes(sf::RenderWindow& window) const
         plumes[index] = v;
         index++;
     }
-
-    window.draw(plumes);
 }
 
-const std::vector<Lithosphere::PlatePtr>& Lithosphere::getPlates() const
+template <class Payload>
+const std::vector<typename Lithosphere<Payload>::PlatePtr>& Lithosphere<Payload>::getPlates() const
 {
     return mPlates;
 }
+
+template <class Payload>
+const Random& Lithosphere<Payload>::getRandom() const
+{
+    return mRandom;
+}
+
+template <class Payload>
+const Grid<uint16_t>& Lithosphere<Payload>::getSurface() const
+{
+    return mSurface;
+}
+
+template <class Payload>
+void Lithosphere<Payload>::setSampling(PlateRasterizer::Sampling sampling)
+{
+    mRasterizer.setSampling(sampling);
+}
+
+template class Lithosphere<PreviewPayload>;
+template class Lithosphere<StandardPayload>;
+template class Lithosphere<ResearchPayload>;
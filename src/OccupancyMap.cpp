@@ -0,0 +1,79 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+////////////////////////////////////////////////
+// Tecto library
+#include <OccupancyMap.hpp>
+////////////////////////////////////////////////
+
+OccupancyMap::OccupancyMap(unsigned int sizeX, unsigned int sizeY, unsigned int count)
+: mSizeX(sizeX)
+, mSizeY(sizeY)
+, mWordsPerColumn((sizeY + 63) / 64)
+, mLowBits(sizeX * mWordsPerColumn, ~uint64_t(0)) // Count 1 everywhere, including the padding.
+, mHighBits(sizeX * mWordsPerColumn, 0)
+{
+    for(unsigned int x = 0; x < sizeX; x++)
+        for(unsigned int y = 0; y < sizeY; y++)
+            setCount(x, y, count);
+}
+
+unsigned int OccupancyMap::increment(unsigned int x, unsigned int y)
+{
+    unsigned int count = getCount(x, y);
+    if(count < MAX_COUNT)
+        setCount(x, y, ++count);
+
+    return count;
+}
+
+unsigned int OccupancyMap::decrement(unsigned int x, unsigned int y)
+{
+    unsigned int count = getCount(x, y);
+    if(count > 0)
+        setCount(x, y, --count);
+
+    return count;
+}
+
+unsigned int OccupancyMap::getCount(unsigned int x, unsigned int y) const
+{
+    std::size_t iWord = x * mWordsPerColumn + y / 64;
+    unsigned int bit = y % 64;
+    return ((mLowBits[iWord] >> bit) & 1) | (((mHighBits[iWord] >> bit) & 1) << 1);
+}
+
+void OccupancyMap::setCount(unsigned int x, unsigned int y, unsigned int count)
+{
+    if(count > MAX_COUNT)
+        count = MAX_COUNT;
+
+    std::size_t iWord = x * mWordsPerColumn + y / 64;
+    uint64_t mask = uint64_t(1) << (y % 64);
+    mLowBits[iWord] = (mLowBits[iWord] & ~mask) | ((count & 1) ? mask : 0);
+    mHighBits[iWord] = (mHighBits[iWord] & ~mask) | ((count & 2) ? mask : 0);
+}
+
+std::size_t OccupancyMap::getMemoryUsage() const
+{
+    return (mLowBits.size() + mHighBits.size()) * sizeof(uint64_t);
+}
@@ -24,6 +24,7 @@
 // Tecto library
 #include <Plate.hpp>
 #include <Utility.hpp>
+#include <RotationKernel.hpp>
 ////////////////////////////////////////////////
 
 ////////////////////////////////////////////////
@@ -32,6 +33,7 @@
 // DEBUG
 #include <iostream>
 #include <cassert>
+#include <cmath>
 #include <functional>
 //////////////////////
 ////////////////////////////////////////////////
@@ -42,76 +44,170 @@
 #include <SFML/Graphics/RenderWindow.hpp>
 ////////////////////////////////////////////////
 
-Plate::Plate(std::vector<std::vector<Crust>>& heightmap, sf::Vector2u worldSize, std::list<BorderCrust> border)
-: mHeightmap(heightmap)
-, mBorder(border)
-, mRotationalVelocity(0)
+namespace
 {
-    mWorldSize.x = worldSize.x;
-    mWorldSize.y = worldSize.y;
+    // The border normals are only used for sign tests, so they can lag
+    // behind the rotation of the plate this much.
+    const float NORMAL_REFRESH_DEGREES = 5.f;
 
-    mWorldSizef.x = mWorldSize.x;
-    mWorldSizef.y = mWorldSize.y;
+    inline bool hasTurnedPast(double from, double to, float degrees)
+    {
+        return std::abs(std::remainder(to - from, 360.0)) >= degrees;
+    }
 
+    inline bool hasTurnedPast(Angle from, Angle to, float degrees)
+    {
+        int32_t turn = int32_t(to - from);
+        return uint32_t(turn < 0 ? -int64_t(turn) : turn) >= degreesToAngle(Fixed(degrees));
+    }
+
+    const std::size_t MIN_BORDER_SIZE = 3;
+
+    // Scratch memory a tick needs per border crust, with room to spare for
+    // ticks that move crusts more than one cell or fill many gaps.
+    const std::size_t SCRATCH_BYTES_PER_CRUST = 256;
 
-    sf::Vector2i origin = mBorder.begin()->getIndex();
-    mRotationalCenter = sf::Vector2f(origin.x, origin.y);
+    // Border crusts per task when a plate update is split up. Big plates
+    // split into many tasks that idle threads can steal.
+    const std::size_t BORDER_CHUNK_SIZE = 1024;
 
-    for(BorderCrust& crust : mBorder)
+    std::size_t getChunkCount(std::size_t borderSize)
     {
-        sf::Vector2i index = crust.getIndex();
-        sf::Vector2f vRadius(index.x - mRotationalCenter.x, index.y - mRotationalCenter.y);
-        crust.offsetRadiusVector(vRadius);
+        return (borderSize + BORDER_CHUNK_SIZE - 1) / BORDER_CHUNK_SIZE;
     }
 
-    mOldCrustIndices.resize(mBorder.size());
-    mNewCrustIndices.resize(mBorder.size());
-    initializeDrawMap();
-}
+    // Call function(begin, end) for every chunk [begin, end) of a border of
+    // borderSize crusts, on threadPool if there is one.
+    template <class Function>
+    void forEachChunk(ThreadPool* threadPool, std::size_t borderSize, Function& function)
+    {
+        auto handleChunk = [borderSize, &function](std::size_t iChunk)
+        {
+            std::size_t begin = iChunk * BORDER_CHUNK_SIZE;
+            function(begin, std::min(begin + BORDER_CHUNK_SIZE, borderSize));
+        };
 
+        if(threadPool)
+            threadPool->forEach(getChunkCount(borderSize), handleChunk);
+        else
+        {
+            for(std::size_t iChunk = 0; iChunk < getChunkCount(borderSize); iChunk++)
+                handleChunk(iChunk);
+        }
+    }
 
-void Plate::update(float years)
-{
-    sf::Vector2f distance = mVelocity * years;
-    float rotation = mRotationalVelocity * years;
+#ifdef TECTO_FIXED_POINT
+    // Keep distance, in 2^-32:ths of a cell, within one world size on an axis
+    // of size cells. Whole turns are left out where the axis wraps around, and
+    // the plate is stopped at the edge of the world where it does not.
+    int64_t limitDistance(int64_t distance, int size, bool wraps)
+    {
+        int64_t turn = int64_t(size) << (2 * Fixed::FRACTION_BITS);
+        return wraps ? distance % turn : std::min(std::max(distance, -turn), turn);
+    }
+#endif // TECTO_FIXED_POINT
 
-    move(distance);
-    rotate(rotation);
+    int getChebyshevLength(sf::Vector2i v)
+    {
+        return std::max(std::abs(v.x), std::abs(v.y));
+    }
 
-    moveBorder(distance, rotation);
-    updateBorder();
+    // value / divisor rounded to the nearest integer. divisor must be positive.
+    int divideRounded(int value, int divisor)
+    {
+        return value >= 0 ? (2 * value + divisor) / (2 * divisor) : -((-2 * value + divisor) / (2 * divisor));
+    }
+
+    // Cell step of the 8-connected line from (0, 0) to delta, which is steps
+    // cells long. Neighbouring steps are neighbouring cells.
+    sf::Vector2i getLineCell(sf::Vector2i delta, int step, int steps)
+    {
+        return sf::Vector2i(divideRounded(delta.x * step, steps), divideRounded(delta.y * step, steps));
+    }
 }
 
-void Plate::draw(sf::RenderWindow& window)
+Plate::Plate(sf::Vector2u worldSize, const std::vector<BorderCrust>& border, const CellSet& cells)
+: mTopology(sf::Vector2i(worldSize.x, worldSize.y))
+, mBorder(border, sf::Vector2i(worldSize.x, worldSize.y))
+, mCells(cells)
+, mTranslation(0, 0)
+, mRotation(0)
+, mNormalRotation(0)
+, mRotationalVelocity(0)
+#ifdef TECTO_FIXED_POINT
+, mDistance(0, 0)
+, mTurn(0)
+#else
+, mStartTranslation(0, 0)
+, mStartRotation(0)
+, mMotionTimeSteps(0)
+#endif // TECTO_FIXED_POINT
+, mCrossingMargin(0)
+, mMaxRadius(0)
+, mSine(0)
+, mCosine(1)
+, mRotationalCenterMarker(sf::Quads, 4)
+, mArena(border.size() * SCRATCH_BYTES_PER_CRUST)
 {
-    sf::VertexArray rotationalCenter(sf::Quads, 4);
-    rotationalCenter[0].position = mRotationalCenter - sf::Vector2f(2, 2);
-    rotationalCenter[0].color = sf::Color::Red;
+    mWorldSize.x = worldSize.x;
+    mWorldSize.y = worldSize.y;
+#ifdef TECTO_FIXED_POINT
+    assert(mWorldSize.x <= MAX_FIXED_WORLD_SIZE && mWorldSize.y <= MAX_FIXED_WORLD_SIZE);
+#endif // TECTO_FIXED_POINT
 
-    rotationalCenter[1].position = mRotationalCenter + sf::Vector2f(2, -2);
-    rotationalCenter[1].color = sf::Color::Red;
 
-    rotationalCenter[2].position = mRotationalCenter + sf::Vector2f(2, 2);
-    rotationalCenter[2].color = sf::Color::Red;
+    sf::Vector2i origin = mBorder.getIndex(0);
+    mOrigin = sf::Vector2<Coordinate>(origin.x, origin.y);
+    mRotationalCenter = mOrigin;
 
-    rotationalCenter[3].position = mRotationalCenter + sf::Vector2f(-2, 2);
-    rotationalCenter[3].color = sf::Color::Red;
+    for(unsigned int i = 0; i < mRotationalCenterMarker.getVertexCount(); i++)
+        mRotationalCenterMarker[i].color = sf::Color::Red;
 
-    window.draw(rotationalCenter);
-    drawBorder(window);
+    initializeDrawMap();
+    updatePose(nullptr);
+    mBorder.updateNormals();
+    updateCrossingMargin();
+}
+
+
+// The pose is computed from the total translation and rotation, not built up
+// tick by tick, so any number of years can be simulated in one call.
+void Plate::update(int64_t timeSteps, ThreadPool& threadPool)
+{
+    advance(timeSteps);
+
+    updatePose(&threadPool);
+    updateNormals();
+    updateBorder(threadPool);
+}
+
+// Give back the buffers of this tick. Call at the end of every tick.
+void Plate::resetScratch()
+{
+    mNewCrustIndices.clear();
+    mOldCrustIndices.clear();
+    mArena.reset();
+
+    // Grow the draw map with the border here, so that updatePose() never has to.
+    std::size_t vertexCount = mDrawMap.getVertexCount();
+    if(vertexCount < mBorder.getCapacity())
+    {
+        mDrawMap.resize(mBorder.getCapacity());
+        for(std::size_t i = vertexCount; i < mDrawMap.getVertexCount(); i++)
+            mDrawMap[i].color = sf::Color(0, 0, 0, 0);
+    }
 }
 
-void Plate::fitIndexToWorldmap(sf::Vector2i& index)
+void Plate::draw(sf::RenderWindow& window)
 {
-    if(index.x < 0)
-        index.x = (mWorldSize.x - 1) - (-index.x % mWorldSize.x);
-    else if(index.x > mWorldSize.x - 1)
-        index.x = index.x % mWorldSize.x;
+    sf::Vector2f center(mRotationalCenter);
+    mRotationalCenterMarker[0].position = center - sf::Vector2f(2, 2);
+    mRotationalCenterMarker[1].position = center + sf::Vector2f(2, -2);
+    mRotationalCenterMarker[2].position = center + sf::Vector2f(2, 2);
+    mRotationalCenterMarker[3].position = center + sf::Vector2f(-2, 2);
 
-    if(index.y < 0)
-        index.y = (mWorldSize.y - 1) - (-index.y % mWorldSize.y);
-    else if(index.y > mWorldSize.y - 1)
-        index.y = index.y % mWorldSize.y;
+    window.draw(mRotationalCenterMarker);
+    drawBorder(window);
 }
 
 /*
@@ -132,7 +228,7 @@ void Plate::initializeDrawMap()
             sf::Vector2f pos = sf::Vector2f(iY.getIndex().x, iY.getIndex().y);
             pos = mTransform.transformPoint(pos);
             pos += mTranslation;
-            fitPositionToWorldmap(pos);
+            pos = mTopology.wrapPosition(pos);
 
             vertex.position = pos;
             vertex.color.g = iY.getHeight() > 255 ? 255 : iY.getHeight();
@@ -142,232 +238,413 @@ void Plate::initializeDrawMap()
     }
 }
 */
-void Plate::fitPositionToWorldmap(sf::Vector2f& pos)
+// Move and rotate the plate by its velocities over timeSteps more.
+void Plate::advance(int64_t timeSteps)
 {
-    if(pos.x >= mWorldSizef.x)
-        while(pos.x >= mWorldSizef.x)
-            pos.x -= mWorldSizef.x;
-    else if(pos.x < 0.f)
-        while(pos.x < 0.f)
-            pos.x += mWorldSizef.x;
-
-    if(pos.y >= mWorldSizef.y)
-        while(pos.y >= mWorldSizef.y)
-            pos.y -= mWorldSizef.y;
-    else if(pos.y < 0.f)
-        while(pos.y < 0.f)
-            pos.y += mWorldSizef.y;
+#ifdef TECTO_FIXED_POINT
+    // Velocity in 2^-16 cells per year times 2^-16:ths of a year is exact.
+    mDistance.x = limitDistance(mDistance.x + int64_t(mVelocity.x.getRaw()) * timeSteps, mWorldSize.x, Topology::WRAPS_X);
+    mDistance.y = limitDistance(mDistance.y + int64_t(mVelocity.y.getRaw()) * timeSteps, mWorldSize.y, Topology::WRAPS_Y);
+    mTranslation.x = Fixed::fromRaw(int32_t(mDistance.x >> Fixed::FRACTION_BITS));
+    mTranslation.y = Fixed::fromRaw(int32_t(mDistance.y >> Fixed::FRACTION_BITS));
+
+    // 2^32 angle units per 360 degrees.
+    mTurn = (mTurn + int64_t(mRotationalVelocity.getRaw()) * timeSteps) % (int64_t(360) << (2 * Fixed::FRACTION_BITS));
+    mRotation = Angle(mTurn / 360);
+#else
+    mMotionTimeSteps += timeSteps;
+    double years = double(mMotionTimeSteps) / TIME_STEPS_PER_YEAR;
+
+    // Shave mTranslation down when the plate has moved a whole "turn" around the world.
+    mTranslation = mTopology.wrapTranslation(mStartTranslation + Translation(mVelocity.x * years, mVelocity.y * years));
+    mRotation = std::fmod(mStartRotation + mRotationalVelocity * years, 360.0);
+#endif // TECTO_FIXED_POINT
+    mRotationalCenter = mTopology.wrapPosition(mOrigin + sf::Vector2<Coordinate>(mTranslation));
 }
 
-void Plate::move(sf::Vector2f distance)
+// Move every crust straight to the cell it is now in, however far away, and
+// record the cells it passes on the way.
+void Plate::updateBorder(ThreadPool& threadPool)
 {
-    mRotationalCenter += distance;
-    mTranslation += distance;
-    loopCoords(mRotationalCenter);
-    loopTranslation(); // Shave mTranslation down when the plate has moved a whole "turn" around the world.
-}
-
-void Plate::loopCoords(sf::Vector2f& coords)
-{
-    while(coords.x >= mWorldSizef.x)
-        coords.x -= mWorldSizef.x;
-    while(coords.x < 0.f)
-        coords.x += mWorldSizef.x;
-
-    while(coords.y >= mWorldSizef.y)
-        coords.y -= mWorldSizef.y;
-    while(coords.y < 0.f)
-        coords.y += mWorldSizef.y;
-}
+    std::size_t size = mBorder.getSize();
+    std::size_t chunkCount = getChunkCount(size);
+    sf::Vector2i* deltas = mArena.allocate<sf::Vector2i>(size);
+    std::size_t* newStarts = mArena.allocate<std::size_t>(chunkCount + 1);
+    std::size_t* oldStarts = mArena.allocate<std::size_t>(chunkCount + 1);
+
+    // A crust that moves outwards covers the cells on its way, and one that
+    // moves inwards leaves them. One that slides along the border does both.
+    auto getSide = [this](std::size_t iCrust, sf::Vector2i delta)
+    {
+        sf::Vector2<Coordinate> normal = mBorder.getNormal(iCrust);
+        return Coordinate(delta.x) * normal.x + Coordinate(delta.y) * normal.y;
+    };
 
-void Plate::loopTranslation()
-{
-    if(mTranslation.x > mWorldSize.x)
-        while(mTranslation.x > mWorldSize.x)
-            mTranslation.x -= mWorldSize.x;
-    else if(mTranslation.x < -mWorldSize.x)
-        while(mTranslation.x < -mWorldSize.x)
-            mTranslation.x += mWorldSize.x;
+    // Count the cells each chunk covers and leaves, so that the chunks know
+    // where in the lists their cells go.
+    auto measureChunk = [this, deltas, newStarts, oldStarts, &getSide](std::size_t begin, std::size_t end)
+    {
+        std::size_t newCount = 0;
+        std::size_t oldCount = 0;
+        for(std::size_t iCrust = begin; iCrust < end; iCrust++)
+        {
+            sf::Vector2<Coordinate> position = mRotationalCenter + mBorder.getRadiusVector(iCrust);
+            sf::Vector2i target = mTopology.wrapIndex(sf::Vector2i(roundToInt(position.x), roundToInt(position.y)));
+            deltas[iCrust] = mTopology.getDelta(mBorder.getIndex(iCrust), target);
+
+            int steps = getChebyshevLength(deltas[iCrust]);
+            if(steps == 0)
+                continue;
+
+            Coordinate side = getSide(iCrust, deltas[iCrust]);
+            if(side >= 0)
+                newCount += steps;
+            if(side <= 0)
+                oldCount += steps;
+        }
 
-    if(mTranslation.y > mWorldSize.y)
-        while(mTranslation.y > mWorldSize.y)
-            mTranslation.y -= mWorldSize.y;
-    else if(mTranslation.y < -mWorldSize.y)
-        while(mTranslation.y < -mWorldSize.y)
-            mTranslation.y += mWorldSize.y;
-}
+        newStarts[begin / BORDER_CHUNK_SIZE + 1] = newCount;
+        oldStarts[begin / BORDER_CHUNK_SIZE + 1] = oldCount;
+    };
+    forEachChunk(&threadPool, size, measureChunk);
 
-void Plate::updateBorder()
-{
-    // Update border crusts.
-    mNewCrustIndices[0] = nullptr;
-    mOldCrustIndices.clear();
+    newStarts[0] = 0;
+    oldStarts[0] = 0;
+    for(std::size_t iChunk = 0; iChunk < chunkCount; iChunk++)
+    {
+        newStarts[iChunk + 1] += newStarts[iChunk];
+        oldStarts[iChunk + 1] += oldStarts[iChunk];
+    }
 
-    for(BorderCrust& crust : mBorder)
-        crust.update();
+    mNewCrustIndices.allocate(mArena, newStarts[chunkCount]);
+    mNewCrustIndices.resize(newStarts[chunkCount]);
+    mOldCrustIndices.allocate(mArena, oldStarts[chunkCount]);
+    mOldCrustIndices.resize(oldStarts[chunkCount]);
 
-    std::list<BorderCrust>::iterator iNext, iPrevious;
-    iNext = mBorder.begin();
-    iNext++;
-    iPrevious = mBorder.end();
-    iPrevious--;
-    unsigned int iNewCrust = 0;
-    for(auto iCrust = mBorder.begin(); iCrust != mBorder.end(); iCrust++)
+    // The cells come out in the same order as from one walk along the border.
+    auto moveChunk = [this, deltas, newStarts, oldStarts, &getSide](std::size_t begin, std::size_t end)
     {
-        sf::Vector2i indexChange;
-        sf::Vector2i index = iCrust->getIndex();
-        sf::Vector2f indexf(index.x, index.y);
-        sf::Vector2f positionf = mRotationalCenter + iCrust->getRadiusVector();
-        if(positionf.x > indexf.x)
-            indexChange.x = 1;
-        else if(positionf.x < indexf.x)
-            indexChange.x = -1;
-        else
-            indexChange.x = 0;
-
-        if(positionf.y > indexf.y)
-            indexChange.y = 1;
-        else if(positionf.y < indexf.y)
-            indexChange.y = -1;
-        else
-            indexChange.y = 0;
+        std::size_t iNew = newStarts[begin / BORDER_CHUNK_SIZE];
+        std::size_t iOld = oldStarts[begin / BORDER_CHUNK_SIZE];
+        ChainCode::Decoder original = mBorder.getOriginalIndices(begin);
+        for(std::size_t iCrust = begin; iCrust < end; iCrust++, ++original)
+        {
+            sf::Vector2i delta = deltas[iCrust];
+            int steps = getChebyshevLength(delta);
+            if(steps == 0)
+                continue;
+
+            sf::Vector2i index = mBorder.getIndex(iCrust);
+            Coordinate side = getSide(iCrust, delta);
+            if(side >= 0)
+            {
+                for(int step = 1; step <= steps; step++)
+                {
+                    CrustStep crustStep = {mTopology.wrapIndex(index + getLineCell(delta, step, steps)), *original, mBorder.getSourceHandle(iCrust)};
+                    mNewCrustIndices[iNew++] = crustStep;
+                }
+            }
+            if(side <= 0)
+            {
+                for(int step = 0; step < steps; step++)
+                    mOldCrustIndices[iOld++] = mTopology.wrapIndex(index + getLineCell(delta, step, steps));
+            }
 
+            mBorder.setIndex(iCrust, mTopology.wrapIndex(index + delta));
+        }
+    };
+    forEachChunk(&threadPool, size, moveChunk);
 
+    closeGaps();
+    updateCrossingMargin();
+}
 
-        if(indexChange.x != 0 && indexChange.y != 0)
+// Keep the border 8-connected. A crust in the same cell as the crust before
+// it is erased, and crusts are added on the cells between crusts that have
+// moved apart. Everything is spliced in one pass over the border.
+void Plate::closeGaps()
+{
+    std::size_t size = mBorder.getSize();
+    bool* erase = mArena.allocate<bool>(size);
+    erase[0] = false;
+
+    std::size_t keptCount = size;
+    std::size_t insertionCount = 0;
+    std::size_t previous = 0;
+    for(std::size_t iCrust = 1; iCrust < size; iCrust++)
+    {
+        int distance = getChebyshevLength(mTopology.getDelta(mBorder.getIndex(previous), mBorder.getIndex(iCrust)));
+        erase[iCrust] = distance == 0 && keptCount > MIN_BORDER_SIZE;
+        if(erase[iCrust])
         {
-            index += indexChange;
-            fitIndexToWorldmap(index);
-            iCrust->setIndex(index.x, index.y);
+            keptCount--;
+            continue;
+        }
 
-            sf::Vector2f radiusVector = iCrust->getRadiusVector();//iCrust->getPosition();
-            sf::Vector2f dNext = iNext->getRadiusVector() - radiusVector;
-            sf::Vector2f dPrev = iPrevious->getRadiusVector() - radiusVector;
-            //sf::Vector2f dNext = iNext->getPosition() - pos;
-            //sf::Vector2f dPrev = iPrevious->getPosition() - pos;
+        insertionCount += std::max(distance - 1, 0);
+        previous = iCrust;
+    }
 
+    // The last crust kept is followed by the first one.
+    int distance = getChebyshevLength(mTopology.getDelta(mBorder.getIndex(previous), mBorder.getIndex(0)));
+    insertionCount += std::max(distance - 1, 0);
 
+    if(insertionCount == 0 && keptCount == size)
+        return;
 
-            bool isFrontCrust = false;
-            if(indexChange.x > 0)
-            {
-                if(dNext.y > 0 && dPrev.y < 0)
-                    isFrontCrust = true;
-            }
-            else if(indexChange.x < 0)
-            {
-                if(dNext.y < 0 && dPrev.y > 0)
-                    isFrontCrust = true;
-            }
+    Border::Insertion* insertions = mArena.allocate<Border::Insertion>(insertionCount);
+    insertionCount = 0;
+    previous = 0;
+    for(std::size_t iCrust = 1; iCrust < size; iCrust++)
+    {
+        if(erase[iCrust])
+            continue;
 
-            if(indexChange.y > 0)
-            {
-                if(dNext.x < 0 && dPrev.x > 0)
-                    isFrontCrust = true;
-            }
-            else if(indexChange.y > 0)
-            {
-                if(dNext.x > 0 && dPrev.x < 0)
-                    isFrontCrust = true;
-            }
+        addGapCrusts(previous, mTopology.getDelta(mBorder.getIndex(previous), mBorder.getIndex(iCrust)), iCrust, insertions, insertionCount);
+        previous = iCrust;
+    }
 
-            if(isFrontCrust)
-            {
-                mNewCrustIndices[iNewCrust] = (&(*iCrust));
-                iNewCrust++;
-            }
-        }
+    addGapCrusts(previous, mTopology.getDelta(mBorder.getIndex(previous), mBorder.getIndex(0)), size, insertions, insertionCount);
+    mBorder.splice(erase, insertions, insertionCount, mArena);
+}
 
+// Add crusts on the cells of the line from crust from to the crust delta
+// away, both left out, to be inserted before position. A new crust comes
+// from the point of the original plate that has moved to the middle of its
+// cell, so it moves with the plate from then on.
+void Plate::addGapCrusts(std::size_t from, sf::Vector2i delta, std::size_t position, Border::Insertion* insertions, std::size_t& insertionCount) const
+{
+    int steps = getChebyshevLength(delta);
+    if(steps < 2)
+        return;
 
+    sf::Vector2<Coordinate> start = mRotationalCenter + mBorder.getRadiusVector(from);
+    sf::Vector2i startCell(roundToInt(start.x), roundToInt(start.y));
+    for(int step = 1; step < steps; step++)
+    {
+        sf::Vector2i cell = startCell + getLineCell(delta, step, steps);
+        sf::Vector2<Coordinate> radius(Coordinate(cell.x) - mRotationalCenter.x, Coordinate(cell.y) - mRotationalCenter.y);
+        sf::Vector2<Coordinate> original(   mOrigin.x + mCosine * radius.x + mSine * radius.y,
+                                            mOrigin.y - mSine * radius.x + mCosine * radius.y);
+        sf::Vector2i originalCell = mTopology.wrapIndex(sf::Vector2i(roundToInt(original.x), roundToInt(original.y)));
+
+        // The offset is from the wrapped cell, so it also undoes the wrapping.
+        Border::Insertion& insertion = insertions[insertionCount++];
+        insertion.mPosition = position;
+        insertion.mIndex = mTopology.wrapIndex(cell);
+        insertion.mOriginalIndex = originalCell;
+        insertion.mOriginalOffset = original - sf::Vector2<Coordinate>(Coordinate(originalCell.x), Coordinate(originalCell.y));
+        insertion.mRadiusVector = radius;
+    }
+}
 
-        iNext++;
-        iPrevious++;
+// Find how far the border can move before some crust enters another cell.
+void Plate::updateCrossingMargin()
+{
+    using std::abs;
 
-        if(iNext == mBorder.end())
-            iNext = mBorder.begin();
+    const Coordinate HALF_CELL = Coordinate(0.5f);
 
-        if(iPrevious == mBorder.end())
-            iPrevious = mBorder.begin();
+    mCrossingMargin = HALF_CELL;
+    mMaxRadius = 0;
+    for(std::size_t iCrust = 0; iCrust < mBorder.getSize(); iCrust++)
+    {
+        sf::Vector2i index = mBorder.getIndex(iCrust);
+        sf::Vector2<Coordinate> radius = mBorder.getRadiusVector(iCrust);
+        sf::Vector2<Coordinate> position = mRotationalCenter + radius;
+        sf::Vector2i cell(roundToInt(position.x), roundToInt(position.y));
+
+        // A crust that still lags behind its cell must be moved right away.
+        if(mTopology.wrapIndex(cell) != index)
+            mCrossingMargin = 0;
+
+        Coordinate offset = std::max(abs(position.x - Coordinate(cell.x)), abs(position.y - Coordinate(cell.y)));
+        mCrossingMargin = std::min(mCrossingMargin, HALF_CELL - offset);
+        mMaxRadius = std::max(mMaxRadius, abs(radius.x) + abs(radius.y));
     }
-
-    mNewCrustIndices[iNewCrust] = nullptr;
 }
 
 
 void Plate::setVelocity(float x, float y)
 {
-    mVelocity = sf::Vector2f(x, y);
+#ifndef TECTO_FIXED_POINT
+    restartMotion();
+#endif // TECTO_FIXED_POINT
+    mVelocity = sf::Vector2<Coordinate>(Coordinate(x), Coordinate(y));
 }
 
 sf::Vector2f Plate::getVelocity() const
 {
-    return mVelocity;
+    return sf::Vector2f(mVelocity);
 }
 
-const std::vector<sf::Vector2i>& Plate::getOldCrustIndices() const
+const ScratchVector<sf::Vector2i>& Plate::getOldCrustIndices() const
 {
     return mOldCrustIndices;
 }
 
-const std::vector<BorderCrust*>& Plate::getNewCrustIndices() const
+const ScratchVector<CrustStep>& Plate::getNewCrustIndices() const
 {
     return mNewCrustIndices;
 }
 
-void Plate::setRotationalVelocity(float degrees)
+Border& Plate::getBorder()
 {
-    mRotationalVelocity = degrees;
+    return mBorder;
 }
 
-void Plate::rotate(float degrees)
+const Border& Plate::getBorder() const
 {
-    mRotation += degrees;
+    return mBorder;
+}
 
-    if(mRotation > 360.f)
-        mRotation -= 360.f;
+Coordinate Plate::getCrossingMargin() const
+{
+    return mCrossingMargin;
+}
 
-    mTransform.rotate(degrees, mRotationalCenter);
+// Upper bound of how many cells per year any border crust moves, measured as
+// |dx| + |dy| so that it never underestimates.
+Coordinate Plate::getMaxSpeed() const
+{
+    using std::abs;
+
+    const Coordinate RADIANS_PER_DEGREE = Coordinate(PI / 180.f);
+    return abs(mVelocity.x) + abs(mVelocity.y) + abs(Coordinate(mRotationalVelocity)) * RADIANS_PER_DEGREE * mMaxRadius;
+}
+
+void Plate::setRotationalVelocity(float degrees)
+{
+#ifndef TECTO_FIXED_POINT
+    restartMotion();
+#endif // TECTO_FIXED_POINT
+    mRotationalVelocity = RotationalVelocity(degrees);
+}
+
+#ifndef TECTO_FIXED_POINT
+// The pose is the pose at the last velocity change plus the velocity times
+// the time since, so that it does not depend on how that time was split up.
+void Plate::restartMotion()
+{
+    mStartTranslation = mTranslation;
+    mStartRotation = mRotation;
+    mMotionTimeSteps = 0;
+}
+#endif // TECTO_FIXED_POINT
+
+// Turn the border normals with the plate once it has turned far enough.
+void Plate::updateNormals()
+{
+    if(hasTurnedPast(mNormalRotation, mRotation, NORMAL_REFRESH_DEGREES))
+    {
+        mBorder.updateNormals();
+        mNormalRotation = mRotation;
+    }
 }
 
-void Plate::moveBorder(sf::Vector2f distance, float degrees)
+// Place the border where the pose says. The radius vectors are computed from
+// the original indices every time, so no error builds up between ticks.
+void Plate::updatePose(ThreadPool* threadPool)
 {
-    // Now compute the rotation modifiers
-    // for the current rotation change
-    float radians = degreeToRadian(degrees);
-    double s = std::sin(radians);
-    double c = std::cos(radians);
-    unsigned int iDrawMap = 0;
-    for(BorderCrust& crust : mBorder)
+#ifdef TECTO_FIXED_POINT
+    float degrees = angleToDegrees(mRotation);
+    Fixed s = fixedSin(mRotation);
+    Fixed c = fixedCos(mRotation);
+#else
+    float degrees = mRotation;
+    float s = std::sin(degreeToRadian(degrees));
+    float c = std::cos(degreeToRadian(degrees));
+#endif // TECTO_FIXED_POINT
+
+    mTransform = sf::Transform::Identity;
+    mTransform.translate(sf::Vector2f(mRotationalCenter));
+    mTransform.rotate(degrees);
+    mTransform.translate(-sf::Vector2f(mOrigin));
+
+    std::size_t size = mBorder.getSize();
+    Coordinate* originalX = mArena.allocate<Coordinate>(size);
+    Coordinate* originalY = mArena.allocate<Coordinate>(size);
+
+    const Coordinate* offsetsX = mBorder.getOriginalOffsetsX();
+    const Coordinate* offsetsY = mBorder.getOriginalOffsetsY();
+    Coordinate* radiiX = mBorder.getRadiiX();
+    Coordinate* radiiY = mBorder.getRadiiY();
+
+    // The draw map is grown between ticks and hides the vertices it has left over.
+    assert(mDrawMap.getVertexCount() >= size);
+
+    // Rotate every radius vector around the rotational center.
+    auto placeChunk = [&](std::size_t begin, std::size_t end)
     {
-        // Compute how far the crust will move when
-        // rotated around the rotational center.
-        sf::Vector2f vRadius = crust.getRadiusVector();
-        sf::Vector2f vRotation;
-        vRotation.x = vRadius.x * c - vRadius.y * s - vRadius.x;
-        vRotation.y = vRadius.x * s + vRadius.y * c - vRadius.y;
+        ChainCode::Decoder original = mBorder.getOriginalIndices(begin);
+        for(std::size_t i = begin; i < end; i++, ++original)
+        {
+            originalX[i] = Coordinate((*original).x) + offsetsX[i] - mOrigin.x;
+            originalY[i] = Coordinate((*original).y) + offsetsY[i] - mOrigin.y;
+        }
 
+        rotatePoints(originalX + begin, originalY + begin, radiiX + begin, radiiY + begin, end - begin, s, c);
 
-        crust.offsetRadiusVector(vRotation);
-        //crust.move(distance + vRotation);
+        for(std::size_t i = begin; i < end; i++)
+        {
+            mDrawMap[i].position = sf::Vector2f(mRotationalCenter + sf::Vector2<Coordinate>(radiiX[i], radiiY[i]));
+            mDrawMap[i].color = sf::Color(255, 0, 0);
+        }
+    };
+    forEachChunk(threadPool, size, placeChunk);
+    mSine = s;
+    mCosine = c;
 
-        mDrawMap[iDrawMap].position = mRotationalCenter + crust.getRadiusVector();
-        iDrawMap++;
-    }
+    for(std::size_t i = size; i < mDrawMap.getVertexCount(); i++)
+        mDrawMap[i].color = sf::Color(0, 0, 0, 0);
+}
+
+const sf::Transform& Plate::getTransform() const
+{
+    return mTransform;
+}
+
+// Where the crust that started at originalIndex is now. Not looped to the world.
+sf::Vector2f Plate::getPosition(sf::Vector2i originalIndex) const
+{
+    return mTransform.transformPoint(sf::Vector2f(originalIndex.x, originalIndex.y));
+}
+
+const sf::Vector2<Coordinate>& Plate::getOrigin() const
+{
+    return mOrigin;
+}
+
+const sf::Vector2<Coordinate>& Plate::getRotationalCenter() const
+{
+    return mRotationalCenter;
+}
+
+Coordinate Plate::getSine() const
+{
+    return mSine;
+}
+
+Coordinate Plate::getCosine() const
+{
+    return mCosine;
 }
 
 void Plate::initializeDrawMap()
 {
-    mDrawMap = sf::VertexArray(sf::Points, mBorder.size());
+    // One vertex per crust the border has room for. resetScratch() grows it with the border.
+    mDrawMap = sf::VertexArray(sf::Points, mBorder.getCapacity());
 
     sf::Vertex vertex;
     vertex.color = sf::Color(255, 0, 0);
-    unsigned int mapIndex = 0;
-    for(const BorderCrust& crust : mBorder)
+    for(std::size_t i = 0; i < mBorder.getSize(); i++)
     {
-        vertex.position = mRotationalCenter + crust.getRadiusVector();
-        mDrawMap[mapIndex] = vertex;
-        mapIndex++;
+        vertex.position = sf::Vector2f(mRotationalCenter + mBorder.getRadiusVector(i));
+        mDrawMap[i] = vertex;
     }
+
+    for(std::size_t i = mBorder.getSize(); i < mDrawMap.getVertexCount(); i++)
+        mDrawMap[i].color = sf::Color(0, 0, 0, 0);
 }
 
 // Draw the border red!
@@ -376,7 +653,66 @@ void Plate::drawBorder(sf::RenderWindow& window) const
     window.draw(mDrawMap);
 }
 
+sf::Vector2i Plate::getOriginalIndex(sf::Vector2i index) const
+{
+    // Measure from the cell nearest the rotational center, so that the
+    // radius is the short way around the wrapped world.
+    sf::Vector2i centerCell(roundToInt(mRotationalCenter.x), roundToInt(mRotationalCenter.y));
+    sf::Vector2i delta = mTopology.getDelta(mTopology.wrapIndex(centerCell), index);
+    sf::Vector2<Coordinate> radius(Coordinate(centerCell.x + delta.x) - mRotationalCenter.x, Coordinate(centerCell.y + delta.y) - mRotationalCenter.y);
+    sf::Vector2<Coordinate> original(   mOrigin.x + mCosine * radius.x + mSine * radius.y,
+                                        mOrigin.y - mSine * radius.x + mCosine * radius.y);
+    return mTopology.wrapIndex(sf::Vector2i(roundToInt(original.x), roundToInt(original.y)));
+}
+
+sf::Vector2i Plate::getIndex(sf::Vector2i originalIndex) const
+{
+    sf::Vector2i originCell(roundToInt(mOrigin.x), roundToInt(mOrigin.y));
+    sf::Vector2i delta = mTopology.getDelta(mTopology.wrapIndex(originCell), originalIndex);
+    sf::Vector2<Coordinate> radius(Coordinate(originCell.x + delta.x) - mOrigin.x, Coordinate(originCell.y + delta.y) - mOrigin.y);
+    sf::Vector2<Coordinate> position(   mRotationalCenter.x + mCosine * radius.x - mSine * radius.y,
+                                        mRotationalCenter.y + mSine * radius.x + mCosine * radius.y);
+    return mTopology.wrapIndex(sf::Vector2i(roundToInt(position.x), roundToInt(position.y)));
+}
+
 unsigned int Plate::getBorderCrustCount() const
 {
-    return mBorder.size();
+    return mBorder.getSize();
+}
+
+const CellSet& Plate::getCells() const
+{
+    return mCells;
+}
+
+unsigned int Plate::getCrustCount() const
+{
+    return mCells.getCount();
+}
+
+unsigned int Plate::getCrustCount(sf::Vector2i index) const
+{
+    sf::Vector2i original = getOriginalIndex(index);
+    return mCells.contains(original.x * mWorldSize.y + original.y) ? 1 : 0;
+}
+
+std::size_t Plate::getMemoryUsage() const
+{
+    return  mBorder.getMemoryUsage()
+            + mCells.getMemoryUsage()
+            + mArena.getMemoryUsage()
+            + mDrawMap.getVertexCount() * sizeof(sf::Vertex);
+}
+
+unsigned int Plate::getOverlap(const Plate& other) const
+{
+    // The plates are posed differently, so their sets cannot be intersected.
+    unsigned int overlap = 0;
+    mCells.forEachCell([this, &other, &overlap](uint32_t cell)
+    {
+        sf::Vector2i original(cell / mWorldSize.y, cell % mWorldSize.y);
+        overlap += other.getCrustCount(getIndex(original));
+    });
+
+    return overlap;
 }
@@ -0,0 +1,360 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+////////////////////////////////////////////////
+// Tecto library
+#include <PlateRasterizer.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+////////////////////////////////////////////////
+
+namespace
+{
+    const uint16_t NO_PLATE = UINT16_MAX; // Owner of a cell no plate has drawn.
+
+    inline int ceilToInt(Coordinate value)
+    {
+        return -floorToInt(-value);
+    }
+
+    // Spans are walked in 32.32 fixed point whatever Coordinate is, so that
+    // finding the cell under a position is a shift instead of a rounding.
+    inline int64_t toSpanPosition(float value)
+    {
+        return std::llround(double(value) * 4294967296.0);
+    }
+
+    inline int64_t toSpanPosition(Fixed value)
+    {
+        return int64_t(value.getRaw()) << (32 - Fixed::FRACTION_BITS);
+    }
+}
+
+PlateRasterizer::PlateRasterizer(sf::Vector2i worldSize, Sampling sampling)
+: mTopology(worldSize)
+, mSampling(sampling)
+, mFirstColumn(0)
+, mColumnCount(0)
+, mCrossingOffsets(nullptr)
+, mCrossings(nullptr)
+, mPlate(NO_PLATE)
+, mOwners(worldSize.x, worldSize.y, NO_PLATE)
+{
+}
+
+void PlateRasterizer::rasterize(std::size_t plateIndex, const Plate& plate, const Grid<uint16_t>& source, Grid<uint16_t>& target, ThreadPool* threadPool)
+{
+    assert(plateIndex < NO_PLATE);
+    const Border& border = plate.getBorder();
+    mArena.reset();
+    mPlate = uint16_t(plateIndex);
+
+    if(mFootprints.size() <= plateIndex)
+        mFootprints.resize(plateIndex + 1);
+
+    std::vector<Span>& footprint = mFootprints[plateIndex];
+    bool isFirstDraw = footprint.capacity() == 0;
+    clearFootprint(footprint, target);
+
+    if(border.getSize() >= 3)
+    {
+        findCrossings(plate);
+        collectSpans(footprint);
+        if(mSampling == Bilinear)
+            fillSpans<true>(plate, source, target, threadPool);
+        else
+            fillSpans<false>(plate, source, target, threadPool);
+    }
+
+    // The polygon goes through the centers of the border cells, so the fill
+    // leaves out some of them. The border crusts draw themselves.
+    ChainCode::Decoder original = border.getOriginalIndices();
+    for(std::size_t i = 0; i < border.getSize(); i++, ++original)
+    {
+        sf::Vector2i index = border.getIndex(i);
+        target(index.x, index.y) = source((*original).x, (*original).y);
+        mOwners(index.x, index.y) = mPlate;
+        footprint.push_back(Span{index.x, index.y, index.y});
+    }
+
+    // Leave room for the plate to turn and stretch, like its border does.
+    if(isFirstDraw)
+        footprint.reserve(footprint.size() * 2);
+
+    mDirtySpans.insert(mDirtySpans.end(), footprint.begin(), footprint.end());
+}
+
+const std::vector<PlateRasterizer::Span>& PlateRasterizer::getDirtySpans() const
+{
+    return mDirtySpans;
+}
+
+// Leave room for every plate to be cleared and drawn again, so that the list
+// only grows when a footprint does.
+void PlateRasterizer::clearDirtySpans()
+{
+    std::size_t spanCount = 0;
+    for(const std::vector<Span>& footprint : mFootprints)
+        spanCount += footprint.capacity();
+
+    mDirtySpans.clear();
+    mDirtySpans.reserve(2 * spanCount);
+}
+
+void PlateRasterizer::setSampling(Sampling sampling)
+{
+    mSampling = sampling;
+}
+
+PlateRasterizer::Sampling PlateRasterizer::getSampling() const
+{
+    return mSampling;
+}
+
+std::size_t PlateRasterizer::getMemoryUsage() const
+{
+    std::size_t usage = mArena.getMemoryUsage() + mDirtySpans.capacity() * sizeof(Span) + mFootprints.capacity() * sizeof(std::vector<Span>);
+    for(const std::vector<Span>& footprint : mFootprints)
+        usage += footprint.capacity() * sizeof(Span);
+
+    return usage;
+}
+
+// Clear the cells of footprint that are still the plate's own. The rest have
+// been drawn over by other plates since.
+void PlateRasterizer::clearFootprint(std::vector<Span>& footprint, Grid<uint16_t>& target)
+{
+    for(const Span& span : footprint)
+    {
+        forEachCell(span, [this, &target](int x, int y)
+        {
+            if(mOwners(x, y) == mPlate)
+            {
+                target(x, y) = 0;
+                mOwners(x, y) = NO_PLATE;
+            }
+        });
+    }
+
+    mDirtySpans.insert(mDirtySpans.end(), footprint.begin(), footprint.end());
+    footprint.clear();
+}
+
+// Find where every column of the world crosses the border polygon. The
+// positions are not wrapped, so a plate on the edge of the world covers
+// columns outside of it.
+void PlateRasterizer::findCrossings(const Plate& plate)
+{
+    const Border& border = plate.getBorder();
+    const sf::Vector2<Coordinate>& center = plate.getRotationalCenter();
+    std::size_t size = border.getSize();
+
+    Coordinate minX = border.getRadiusVector(0).x;
+    Coordinate maxX = minX;
+    for(std::size_t i = 1; i < size; i++)
+    {
+        Coordinate x = border.getRadiusVector(i).x;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+    }
+
+    mFirstColumn = ceilToInt(center.x + minX);
+    mColumnCount = std::max(floorToInt(center.x + maxX) - mFirstColumn + 1, 0);
+    mCrossingOffsets = mArena.allocate<uint32_t>(mColumnCount + 1);
+    std::fill(mCrossingOffsets, mCrossingOffsets + mColumnCount + 1, 0);
+
+    // An edge crosses the columns in [its lowest x, its highest x), so that a
+    // corner on a column is counted once.
+    for(std::size_t i = 0; i < size; i++)
+    {
+        Coordinate a = center.x + border.getRadiusVector(i).x;
+        Coordinate b = center.x + border.getRadiusVector(border.getNext(i)).x;
+        int end = ceilToInt(std::max(a, b));
+        for(int x = ceilToInt(std::min(a, b)); x < end; x++)
+            mCrossingOffsets[x - mFirstColumn + 1]++;
+    }
+
+    for(int i = 0; i < mColumnCount; i++)
+        mCrossingOffsets[i + 1] += mCrossingOffsets[i];
+
+    uint32_t* cursors = mArena.allocate<uint32_t>(mColumnCount);
+    std::copy(mCrossingOffsets, mCrossingOffsets + mColumnCount, cursors);
+    mCrossings = mArena.allocate<Coordinate>(mCrossingOffsets[mColumnCount]);
+
+    for(std::size_t i = 0; i < size; i++)
+    {
+        sf::Vector2<Coordinate> a = center + border.getRadiusVector(i);
+        sf::Vector2<Coordinate> b = center + border.getRadiusVector(border.getNext(i));
+        if(b.x < a.x)
+            std::swap(a, b);
+
+        // t is in [0, 1), so that no product can overflow a Fixed.
+        int end = ceilToInt(b.x);
+        for(int x = ceilToInt(a.x); x < end; x++)
+        {
+            Coordinate t = (Coordinate(x) - a.x) / (b.x - a.x);
+            mCrossings[cursors[x - mFirstColumn]++] = a.y + t * (b.y - a.y);
+        }
+    }
+
+    for(int i = 0; i < mColumnCount; i++)
+        std::sort(mCrossings + mCrossingOffsets[i], mCrossings + mCrossingOffsets[i + 1]);
+}
+
+// The cells between every pair of crossings, in the order fillSpans()
+// draws them within each column.
+void PlateRasterizer::collectSpans(std::vector<Span>& spans) const
+{
+    for(int i = 0; i < mColumnCount; i++)
+    {
+        for(uint32_t j = mCrossingOffsets[i]; j + 1 < mCrossingOffsets[i + 1]; j += 2)
+        {
+            Span span = {mFirstColumn + i, ceilToInt(mCrossings[j]), floorToInt(mCrossings[j + 1])};
+            if(clipSpan(span))
+                spans.push_back(span);
+        }
+    }
+}
+
+// Cut span to the world along the axes that do not wrap.
+bool PlateRasterizer::clipSpan(Span& span) const
+{
+    sf::Vector2i worldSize = mTopology.getSize();
+    if(!Topology::WRAPS_X && (span.mX < 0 || span.mX >= worldSize.x))
+        return false;
+
+    if(!Topology::WRAPS_Y)
+    {
+        span.mFirstY = std::max(span.mFirstY, 0);
+        span.mLastY = std::min(span.mLastY, worldSize.y - 1);
+    }
+
+    return span.mFirstY <= span.mLastY;
+}
+
+// Fill the cells between every pair of crossings, BLOCK_SIZE x BLOCK_SIZE
+// cells at a time. Blocks of columns share no cells unless the plate is
+// wider than the world, so then they are filled one by one.
+template <bool BILINEAR>
+void PlateRasterizer::fillSpans(const Plate& plate, const Grid<uint16_t>& source, Grid<uint16_t>& target, ThreadPool* threadPool)
+{
+    auto fillBlock = [this, &plate, &source, &target](std::size_t iBlock)
+    {
+        int block = int(iBlock) * BLOCK_SIZE;
+        int blockEnd = std::min(block + BLOCK_SIZE, mColumnCount);
+
+        int firstRow = INT_MAX;
+        int lastRow = INT_MIN;
+        for(int i = block; i < blockEnd; i++)
+        {
+            if(mCrossingOffsets[i] < mCrossingOffsets[i + 1])
+            {
+                firstRow = std::min(firstRow, ceilToInt(mCrossings[mCrossingOffsets[i]]));
+                lastRow = std::max(lastRow, floorToInt(mCrossings[mCrossingOffsets[i + 1] - 1]));
+            }
+        }
+
+        for(int row = firstRow; row <= lastRow; row += BLOCK_SIZE)
+        {
+            for(int i = block; i < blockEnd; i++)
+            {
+                for(uint32_t j = mCrossingOffsets[i]; j + 1 < mCrossingOffsets[i + 1]; j += 2)
+                {
+                    Span span = {mFirstColumn + i, std::max(ceilToInt(mCrossings[j]), row), std::min(floorToInt(mCrossings[j + 1]), row + BLOCK_SIZE - 1)};
+                    if(clipSpan(span))
+                        fillSegment<BILINEAR>(plate, source, target, span);
+                }
+            }
+        }
+    };
+
+    std::size_t blockCount = (mColumnCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if(threadPool != nullptr && (!Topology::WRAPS_X || mColumnCount <= mTopology.getSize().x))
+        threadPool->forEach(blockCount, fillBlock);
+    else
+        for(std::size_t iBlock = 0; iBlock < blockCount; iBlock++)
+            fillBlock(iBlock);
+}
+
+// Fill the cells of a clipped span. Moving one cell down the column moves
+// the original index by (sine, cosine).
+template <bool BILINEAR>
+void PlateRasterizer::fillSegment(const Plate& plate, const Grid<uint16_t>& source, Grid<uint16_t>& target, const Span& span)
+{
+    sf::Vector2i worldSize = mTopology.getSize();
+    int x = span.mX;
+    int firstY = span.mFirstY;
+    int lastY = span.mLastY;
+
+    const sf::Vector2<Coordinate>& origin = plate.getOrigin();
+    const sf::Vector2<Coordinate>& center = plate.getRotationalCenter();
+    Coordinate s = plate.getSine();
+    Coordinate c = plate.getCosine();
+    Coordinate dx = Coordinate(x) - center.x;
+    Coordinate dy = Coordinate(firstY) - center.y;
+    int64_t sourceX = toSpanPosition(origin.x + c * dx + s * dy);
+    int64_t sourceY = toSpanPosition(origin.y - s * dx + c * dy);
+    int64_t stepX = toSpanPosition(s);
+    int64_t stepY = toSpanPosition(c);
+
+    int worldX = wrapCoordinate(x, worldSize.x);
+    int worldY = wrapCoordinate(firstY, worldSize.y);
+    for(int y = firstY; y <= lastY; y++)
+    {
+        target(worldX, worldY) = sample<BILINEAR>(source, sourceX, sourceY);
+        mOwners(worldX, worldY) = mPlate;
+        sourceX += stepX;
+        sourceY += stepY;
+
+        worldY++;
+        worldY = worldY < worldSize.y ? worldY : 0;
+    }
+}
+
+template <bool BILINEAR>
+uint16_t PlateRasterizer::sample(const Grid<uint16_t>& source, int64_t x, int64_t y) const
+{
+    if(!BILINEAR)
+    {
+        // Halves are rounded up, like roundToInt.
+        const int64_t HALF = int64_t(1) << 31;
+        sf::Vector2i cell = mTopology.wrapIndex(sf::Vector2i((x + HALF) >> 32, (y + HALF) >> 32));
+        return source(cell.x, cell.y);
+    }
+
+    sf::Vector2i first = mTopology.wrapIndex(sf::Vector2i(x >> 32, y >> 32));
+    sf::Vector2i second = mTopology.wrapIndex(sf::Vector2i((x >> 32) + 1, (y >> 32) + 1));
+    uint32_t fractionX = uint32_t(x >> 16) & 0xFFFF;
+    uint32_t fractionY = uint32_t(y >> 16) & 0xFFFF;
+
+    // Weights are in 1/65536ths. Neither sum can overflow.
+    uint32_t top = uint32_t(source(first.x, first.y)) * (65536 - fractionX) + uint32_t(source(second.x, first.y)) * fractionX;
+    uint32_t bottom = uint32_t(source(first.x, second.y)) * (65536 - fractionX) + uint32_t(source(second.x, second.y)) * fractionX;
+    uint64_t value = uint64_t(top) * (65536 - fractionY) + uint64_t(bottom) * fractionY;
+    return uint16_t((value + (uint64_t(1) << 31)) >> 32);
+}
@@ -0,0 +1,99 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+////////////////////////////////////////////////
+// Tecto library
+#include <Random.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cassert>
+////////////////////////////////////////////////
+
+namespace
+{
+    // Constants of Philox4x32 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+    const uint32_t MULTIPLIER_0 = 0xD2511F53;
+    const uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+    const uint32_t KEY_STEP_0 = 0x9E3779B9;
+    const uint32_t KEY_STEP_1 = 0xBB67AE85;
+    const unsigned int ROUND_COUNT = 10;
+
+    // Scramble counter under key. Each counter gives 4 numbers.
+    void philox(uint32_t counter[4], uint32_t key[2])
+    {
+        for(unsigned int round = 0; round < ROUND_COUNT; round++)
+        {
+            uint64_t product0 = uint64_t(MULTIPLIER_0) * counter[0];
+            uint64_t product1 = uint64_t(MULTIPLIER_1) * counter[2];
+            uint32_t next[4] =
+            {
+                uint32_t(product1 >> 32) ^ counter[1] ^ key[0],
+                uint32_t(product1),
+                uint32_t(product0 >> 32) ^ counter[3] ^ key[1],
+                uint32_t(product0)
+            };
+
+            for(unsigned int i = 0; i < 4; i++)
+                counter[i] = next[i];
+
+            key[0] += KEY_STEP_0;
+            key[1] += KEY_STEP_1;
+        }
+    }
+}
+
+Random::Random(uint64_t seed)
+: mSeed(seed)
+{
+}
+
+uint32_t Random::get(uint64_t stream, uint64_t counter) const
+{
+    uint64_t block = counter / 4;
+    uint32_t words[4] = {uint32_t(block), uint32_t(block >> 32), uint32_t(stream), uint32_t(stream >> 32)};
+    uint32_t key[2] = {uint32_t(mSeed), uint32_t(mSeed >> 32)};
+    philox(words, key);
+
+    return words[counter % 4];
+}
+
+// Scaled rather than taken modulo bound, which keeps the high bits and
+// costs no division.
+uint32_t Random::get(uint64_t stream, uint64_t counter, uint32_t bound) const
+{
+    assert(bound > 0);
+    return uint32_t((uint64_t(get(stream, counter)) * bound) >> 32);
+}
+
+float Random::getFloat(uint64_t stream, uint64_t counter) const
+{
+    // The top 24 bits fit a float exactly.
+    return float(get(stream, counter) >> 8) / float(1 << 24);
+}
+
+uint64_t Random::getSeed() const
+{
+    return mSeed;
+}
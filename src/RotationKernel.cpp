@@ -0,0 +1,129 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+////////////////////////////////////////////////
+// Tecto library
+#include <RotationKernel.hpp>
+////////////////////////////////////////////////
+
+#ifdef TECTO_X86
+////////////////////////////////////////////////
+// x86 intrinsics
+#include <immintrin.h>
+////////////////////////////////////////////////
+#endif // TECTO_X86
+
+// Fusing the multiplies and adds would round differently in the kernels
+// that get fused and break bit-compatibility between them.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+void rotatePoints(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c)
+{
+    static const RotationKernel kernel = getRotationKernel();
+    kernel(x, y, rotatedX, rotatedY, count, s, c);
+}
+
+void rotatePoints(const Fixed* x, const Fixed* y, Fixed* rotatedX, Fixed* rotatedY, std::size_t count, Fixed s, Fixed c)
+{
+    int64_t rawS = s.getRaw();
+    int64_t rawC = c.getRaw();
+    for(std::size_t i = 0; i < count; i++)
+    {
+        int64_t rawX = x[i].getRaw();
+        int64_t rawY = y[i].getRaw();
+        int32_t rx = (rawX * rawC - rawY * rawS) >> Fixed::FRACTION_BITS;
+        int32_t ry = (rawX * rawS + rawY * rawC) >> Fixed::FRACTION_BITS;
+        rotatedX[i] = Fixed::fromRaw(rx);
+        rotatedY[i] = Fixed::fromRaw(ry);
+    }
+}
+
+RotationKernel getRotationKernel()
+{
+#ifdef TECTO_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx"))
+        return rotatePointsAVX;
+    if(__builtin_cpu_supports("sse2"))
+        return rotatePointsSSE2;
+#endif // TECTO_X86
+
+    return rotatePointsScalar;
+}
+
+void rotatePointsScalar(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c)
+{
+    for(std::size_t i = 0; i < count; i++)
+    {
+        float rx = x[i] * c - y[i] * s;
+        float ry = x[i] * s + y[i] * c;
+        rotatedX[i] = rx;
+        rotatedY[i] = ry;
+    }
+}
+
+#ifdef TECTO_X86
+__attribute__((target("sse2")))
+void rotatePointsSSE2(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c)
+{
+    const __m128 vs = _mm_set1_ps(s);
+    const __m128 vc = _mm_set1_ps(c);
+
+    std::size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 rx = _mm_sub_ps(_mm_mul_ps(vx, vc), _mm_mul_ps(vy, vs));
+        __m128 ry = _mm_add_ps(_mm_mul_ps(vx, vs), _mm_mul_ps(vy, vc));
+        _mm_storeu_ps(rotatedX + i, rx);
+        _mm_storeu_ps(rotatedY + i, ry);
+    }
+
+    rotatePointsScalar(x + i, y + i, rotatedX + i, rotatedY + i, count - i, s, c);
+}
+
+__attribute__((target("avx")))
+void rotatePointsAVX(const float* x, const float* y, float* rotatedX, float* rotatedY, std::size_t count, float s, float c)
+{
+    const __m256 vs = _mm256_set1_ps(s);
+    const __m256 vc = _mm256_set1_ps(c);
+
+    std::size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 rx = _mm256_sub_ps(_mm256_mul_ps(vx, vc), _mm256_mul_ps(vy, vs));
+        __m256 ry = _mm256_add_ps(_mm256_mul_ps(vx, vs), _mm256_mul_ps(vy, vc));
+        _mm256_storeu_ps(rotatedX + i, rx);
+        _mm256_storeu_ps(rotatedY + i, ry);
+    }
+
+    rotatePointsScalar(x + i, y + i, rotatedX + i, rotatedY + i, count - i, s, c);
+}
+#endif // TECTO_X86
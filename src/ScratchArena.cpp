@@ -0,0 +1,85 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+////////////////////////////////////////////////
+// Tecto library
+#include <ScratchArena.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <cstdint>
+#include <algorithm>
+////////////////////////////////////////////////
+
+ScratchArena::ScratchArena(std::size_t capacity)
+: mBlock(capacity > 0 ? new char[capacity] : nullptr)
+, mCapacity(capacity)
+, mUsed(0)
+, mOverflowBytes(0)
+{
+}
+
+void ScratchArena::reset()
+{
+    // Grow the block so that next tick fits in it. Doubling leaves room for
+    // ticks that need slightly more than this one.
+    if(mOverflowBytes > 0)
+    {
+        mCapacity = std::max(mUsed + mOverflowBytes, mCapacity * 2);
+        mBlock.reset(new char[mCapacity]);
+        mOverflow.clear();
+        mOverflowBytes = 0;
+    }
+
+    mUsed = 0;
+}
+
+std::size_t ScratchArena::getCapacity() const
+{
+    return mCapacity;
+}
+
+std::size_t ScratchArena::getMemoryUsage() const
+{
+    return mCapacity + mOverflowBytes;
+}
+
+void* ScratchArena::allocateBytes(std::size_t bytes, std::size_t alignment)
+{
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(mBlock.get());
+    std::size_t offset = (base + mUsed + alignment - 1) / alignment * alignment - base;
+
+    if(mBlock && offset + bytes <= mCapacity)
+    {
+        mUsed = offset + bytes;
+        return mBlock.get() + offset;
+    }
+
+    // Out of room. Take it from the heap for now.
+    std::size_t size = bytes + alignment;
+    mOverflow.emplace_back(new char[size]);
+    mOverflowBytes += size;
+
+    std::uintptr_t overflow = reinterpret_cast<std::uintptr_t>(mOverflow.back().get());
+    return reinterpret_cast<void*>((overflow + alignment - 1) / alignment * alignment);
+}
@@ -0,0 +1,230 @@
+/****************************************************************
+****************************************************************
+*
+* Tecto - Realistic heightmap generator based on the theories of plate tectonics.
+* Copyright (C) 2013-2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+////////////////////////////////////////////////
+// Tecto library
+#include <ThreadPool.hpp>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <algorithm>
+////////////////////////////////////////////////
+
+namespace
+{
+    // Times an idle worker looks for work before it goes to sleep. Waking
+    // up costs more than a few looks.
+    const unsigned int SPIN_COUNT = 64;
+
+    // The pool whose worker this thread is, and which one.
+    thread_local const ThreadPool* tPool = nullptr;
+    thread_local std::size_t tThreadIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+: mQueuedCount(0)
+, mSleepingCount(0)
+, mIsStopping(false)
+{
+    threadCount = std::max(threadCount, 1u);
+    for(unsigned int i = 0; i < threadCount; i++)
+    {
+        mDeques.emplace_back(new Deque());
+        mDeques.back()->mFront = 0;
+        mDeques.back()->mBack = 0;
+    }
+
+    // The calling thread is one of the threads.
+    for(unsigned int i = 1; i < threadCount; i++)
+        mWorkers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+
+    mWakeUp.notify_all();
+    for(std::thread& worker : mWorkers)
+        worker.join();
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+    return mWorkers.size() + 1;
+}
+
+unsigned int ThreadPool::getDefaultThreadCount()
+{
+    // hardware_concurrency may not know and say 0.
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ThreadPool::run(Call call, void* function, std::size_t count)
+{
+    // Waking the workers costs more than one task.
+    if(mWorkers.empty() || count <= 1)
+    {
+        for(std::size_t i = 0; i < count; i++)
+            call(function, i);
+
+        return;
+    }
+
+    std::atomic<std::size_t> pendingCount(count);
+    runTask(Task{call, function, 0, count, &pendingCount});
+
+    // Help out until the whole loop has returned. The work at hand may be
+    // from this loop or from any other.
+    while(pendingCount.load(std::memory_order_acquire) > 0)
+    {
+        if(!runOtherTask())
+            std::this_thread::yield();
+    }
+}
+
+void ThreadPool::runTask(Task task)
+{
+    while(task.mEnd - task.mBegin > 1)
+    {
+        Task upper = task;
+        upper.mBegin = task.mBegin + (task.mEnd - task.mBegin) / 2;
+        if(!push(upper))
+            break;
+
+        task.mEnd = upper.mBegin;
+    }
+
+    for(std::size_t i = task.mBegin; i < task.mEnd; i++)
+        task.mCall(task.mFunction, i);
+
+    task.mPendingCount->fetch_sub(task.mEnd - task.mBegin, std::memory_order_release);
+}
+
+bool ThreadPool::runOtherTask()
+{
+    Task task;
+    if(!pop(task) && !steal(task))
+        return false;
+
+    runTask(task);
+    return true;
+}
+
+// Push to the back of the deque of this thread.
+bool ThreadPool::push(const Task& task)
+{
+    Deque& deque = *mDeques[getThreadIndex()];
+    {
+        std::lock_guard<std::mutex> lock(deque.mMutex);
+        if(deque.mBack - deque.mFront == DEQUE_CAPACITY)
+            return false;
+
+        deque.mTasks[deque.mBack % DEQUE_CAPACITY] = task;
+        deque.mBack++;
+    }
+
+    // A worker counts itself as sleeping before it looks at the queued
+    // count, so one of the two sees the other.
+    mQueuedCount++;
+    if(mSleepingCount > 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWakeUp.notify_one();
+    }
+
+    return true;
+}
+
+// Pop from the back of the deque of this thread, where the smallest and most
+// recent task is.
+bool ThreadPool::pop(Task& task)
+{
+    Deque& deque = *mDeques[getThreadIndex()];
+    std::lock_guard<std::mutex> lock(deque.mMutex);
+    if(deque.mBack == deque.mFront)
+        return false;
+
+    deque.mBack--;
+    task = deque.mTasks[deque.mBack % DEQUE_CAPACITY];
+    mQueuedCount--;
+    return true;
+}
+
+// Take the oldest, and so biggest, task of another thread. A deque that is
+// busy is passed over rather than waited for.
+bool ThreadPool::steal(Task& task)
+{
+    std::size_t threadIndex = getThreadIndex();
+    for(std::size_t i = 1; i < mDeques.size() && mQueuedCount > 0; i++)
+    {
+        Deque& deque = *mDeques[(threadIndex + i) % mDeques.size()];
+        std::unique_lock<std::mutex> lock(deque.mMutex, std::try_to_lock);
+        if(!lock.owns_lock() || deque.mBack == deque.mFront)
+            continue;
+
+        task = deque.mTasks[deque.mFront % DEQUE_CAPACITY];
+        deque.mFront++;
+        mQueuedCount--;
+        return true;
+    }
+
+    return false;
+}
+
+// Threads other than the workers share the index, and the deque, of the
+// calling thread.
+std::size_t ThreadPool::getThreadIndex() const
+{
+    return tPool == this ? tThreadIndex : 0;
+}
+
+void ThreadPool::work(std::size_t threadIndex)
+{
+    tPool = this;
+    tThreadIndex = threadIndex;
+
+    while(true)
+    {
+        bool hasRun = false;
+        for(unsigned int i = 0; i < SPIN_COUNT && !hasRun; i++)
+        {
+            hasRun = runOtherTask();
+            if(!hasRun)
+                std::this_thread::yield();
+        }
+
+        if(hasRun)
+            continue;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mSleepingCount++;
+        mWakeUp.wait(lock, [this]() { return mIsStopping || mQueuedCount > 0; });
+        mSleepingCount--;
+        if(mIsStopping)
+            return;
+    }
+}
@@ -20,5 +20,23 @@
 ****************************************************************
 ****************************************************************/
 
+////////////////////////////////////////////////
+// Tecto library
 #include <vectorMath.hpp>
+////////////////////////////////////////////////
 
+namespace
+{
+    // Per-axis distance, the short way around on wrapping axes.
+    Vectorf getAxisDistances(Vectorf a, Vectorf b, Vectorf period)
+    {
+        Vectorf d = abs(a - b);
+        return min(d, period - d);
+    }
+}
+
+float getSquaredDistance(Vectorf a, Vectorf b, Vectorf period)
+{
+    Vectorf d = getAxisDistances(a, b, period);
+    return d.x * d.x + d.y * d.y;
+}